@@ -0,0 +1,145 @@
+#include "barrier.hpp"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+
+// pause iterations a waiter spins on the sense before it goes to sleep. a few microseconds, about one K step of a
+// small block size.
+static constexpr auto SPIN_LIMIT = 4096;
+
+bool parseBarrierKind(const std::string& name, BarrierKind& kind) {
+    if (name == "condvar") {
+        kind = BarrierKind::Condvar;
+    } else if (name == "tree") {
+        kind = BarrierKind::Tree;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static int getCoreHopCost(Topology& topo, int from_core, int to_core) {
+    return topo.getHopCost(from_core, topo.getTileByCore(to_core).cha);
+}
+
+// splits members (cores) into groups of up to fan_in: the first unassigned member with its fan_in - 1 nearest
+// unassigned ones, and so on.
+static std::vector<std::vector<int>> groupNearest(Topology& topo, const std::vector<int>& cores, int fan_in) {
+    std::vector<std::vector<int>> groups;
+    std::vector<bool> assigned(cores.size(), false);
+    for (int first = 0; first < cores.size(); ++first) {
+        if (assigned[first]) {
+            continue;
+        }
+        std::vector<std::pair<int, int>> candidates;  // (hops, member)
+        for (int other = first + 1; other < cores.size(); ++other) {
+            if (!assigned[other]) {
+                candidates.emplace_back(getCoreHopCost(topo, cores[first], cores[other]), other);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        std::vector<int> group{first};
+        assigned[first] = true;
+        for (int c = 0; c < candidates.size() && group.size() < fan_in; ++c) {
+            group.push_back(candidates[c].second);
+            assigned[candidates[c].second] = true;
+        }
+        groups.push_back(group);
+    }
+    return groups;
+}
+
+TreeBarrier::TreeBarrier(Topology& topo, const std::vector<int>& thread_to_core, int fan_in)
+    : leaf_of_(thread_to_core.size(), 0), local_senses_(new LocalSense[thread_to_core.size()]) {
+    fan_in = std::max(2, fan_in);
+
+    // leaves over the threads, then levels over the nodes below, each node represented by the core of its first
+    // thread, until one node is left.
+    std::vector<int> members;  // node ids of the level, -1 - thread for threads.
+    std::vector<int> cores = thread_to_core;
+    for (int thread = 0; thread < thread_to_core.size(); ++thread) {
+        members.push_back(-1 - thread);
+    }
+    do {
+        std::vector<int> level;
+        std::vector<int> level_cores;
+        for (const auto& group : groupNearest(topo, cores, fan_in)) {
+            const int node = nodes_.size();
+            nodes_.push_back(std::make_unique<Node>());
+            nodes_.back()->expected = group.size();
+            for (const auto member : group) {
+                if (members[member] < 0) {
+                    leaf_of_[-1 - members[member]] = node;
+                } else {
+                    nodes_[members[member]]->parent = node;
+                }
+            }
+            level.push_back(node);
+            level_cores.push_back(cores[group.front()]);
+        }
+        members = level;
+        cores = level_cores;
+    } while (members.size() > 1);
+}
+
+void TreeBarrier::wait(long thread) {
+    const int sense = 1 - local_senses_[thread].sense;
+    local_senses_[thread].sense = sense;
+
+    int node = leaf_of_[thread];
+    for (;;) {
+        auto& current = *nodes_[node];
+        if (current.count.fetch_add(1, std::memory_order_acq_rel) + 1 < current.expected) {
+            break;
+        }
+        // last of the node. nobody arrives here again before the release.
+        current.count.store(0, std::memory_order_relaxed);
+        if (current.parent < 0) {
+            release(sense);
+            return;
+        }
+        node = current.parent;
+    }
+    waitForRelease(sense);
+}
+
+void TreeBarrier::release(int sense) {
+    sense_.store(sense, std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+        syscall(SYS_futex, reinterpret_cast<int*>(&sense_), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+    }
+}
+
+void TreeBarrier::waitForRelease(int sense) {
+    for (int spin = 0; spin < SPIN_LIMIT; ++spin) {
+        if (sense_.load(std::memory_order_acquire) == sense) {
+            return;
+        }
+        __builtin_ia32_pause();
+    }
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    while (sense_.load(std::memory_order_seq_cst) != sense) {
+        // returns at once if the sense flipped in between.
+        syscall(SYS_futex, reinterpret_cast<int*>(&sense_), FUTEX_WAIT_PRIVATE, 1 - sense, nullptr, nullptr, 0);
+    }
+    sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+CondvarBarrier::CondvarBarrier(long count) : count_(count) {}
+
+void CondvarBarrier::wait() {
+    std::unique_lock lock(mutex_);
+    if (++arrived_ == count_) {
+        arrived_ = 0;
+        ++generation_;
+        released_.notify_all();
+        return;
+    }
+    const long generation = generation_;
+    released_.wait(lock, [&] { return generation_ != generation; });
+}
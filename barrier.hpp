@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "topology.hpp"
+
+// how the threads of a team meet. Condvar is the classic mutex, condition variable and counter, Tree the combining
+// TreeBarrier below.
+enum class BarrierKind { Condvar, Tree };
+
+// "condvar" or "tree".
+bool parseBarrierKind(const std::string& name, BarrierKind& kind);
+
+// combining tree barrier with sense reversal. threads arrive at the counter of their leaf, the last one of a node
+// carries on to its parent and the last one at the root releases everybody by flipping the sense. nodes group threads
+// (and lower nodes) whose cores are the fewest mesh hops apart, so that most arrivals stay on a few nearby tiles.
+// waiters spin on the sense for a while, then sleep on it with a futex.
+class TreeBarrier {
+public:
+    TreeBarrier(Topology& topo, const std::vector<int>& thread_to_core, int fan_in = DEFAULT_FAN_IN);
+
+    void wait(long thread);
+
+    static constexpr int DEFAULT_FAN_IN = 4;
+
+private:
+    struct alignas(64) Node {
+        std::atomic<int> count{0};
+        int expected = 0;
+        int parent = -1;
+    };
+
+    struct alignas(64) LocalSense {
+        int sense = 0;
+    };
+
+    void release(int sense);
+    void waitForRelease(int sense);
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+    std::vector<int> leaf_of_;  // thread -> leaf node.
+    std::unique_ptr<LocalSense[]> local_senses_;
+    alignas(64) std::atomic<int> sense_{0};
+    std::atomic<int> sleepers_{0};
+};
+
+// the condvar barrier for a team of count threads other than the full one.
+class CondvarBarrier {
+public:
+    explicit CondvarBarrier(long count);
+
+    void wait();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable released_;
+    long count_;
+    long arrived_ = 0;
+    long generation_ = 0;
+};
@@ -0,0 +1,17 @@
+#!/bin/bash
+# compares the storage layouts of a. usage: ./bench_layout.sh [processors] [block size] [sizes...]
+# prints n,layout,cha_aware_ms,base_ms per run.
+P=${1:-28}
+B=${2:-16}
+shift $(( $# < 2 ? $# : 2 ))
+SIZES=${@:-4096 8192 16384 32768}
+
+echo "n,layout,cha_aware_ms,base_ms"
+for N in $SIZES; do
+  for LAYOUT in column blocked morton; do
+    OUT=$(./a.out -p$P -n$N -b$B -L$LAYOUT -k)
+    CHA=$(echo "$OUT" | sed -n 's/^Ended cha aware BM. elapsed time: \([0-9]*\)ms/\1/p')
+    BASE=$(echo "$OUT" | sed -n 's/^Ended base BM. elapsed time: \([0-9]*\)ms/\1/p')
+    echo "$N,$LAYOUT,$CHA,$BASE"
+  done
+done
@@ -1 +1,3 @@
-g++ -g -O3 main.cpp cha.cpp topology.cpp -lpthread -lm && ./a.out -p28 -n256 -t
\ No newline at end of file
+g++ -g -O3 calibrate.cpp discovery.cpp latency.cpp cha.cpp topology.cpp -lpthread -o calibrate
+g++ -g -O3 lusim.cpp simulator.cpp trace.cpp cha.cpp topology.cpp -o lusim
+g++ -g -O3 main.cpp barrier.cpp cha.cpp congestion.cpp elastic.cpp hugepage.cpp kernels.cpp layout.cpp matgen.cpp numa.cpp ownership.cpp partition.cpp perf_events.cpp replica.cpp scheduler.cpp slice_allocator.cpp thread_pool.cpp topology.cpp trace.cpp -lpthread -lm && ./a.out -p28 -n256 -t
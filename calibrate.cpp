@@ -0,0 +1,191 @@
+/*************************************************************************/
+/*                                                                       */
+/*  Core-to-core latency calibration of the Topology hop costs           */
+/*                                                                       */
+/*  Ping-pongs a cache line between every pair of the selected cores     */
+/*  and fits latency = base + vertical * |dx| + horizontal * |dy| over   */
+/*  the pairs whose tiles are known. The fitted costs are written into   */
+/*  a mesh config that LU -M and lusim -M load. Measuring works on any   */
+/*  Linux machine, the fit is only meaningful on mesh parts.             */
+/*                                                                       */
+/*  Command line options:                                                */
+/*                                                                       */
+/*  -cC : Comma separated cores C to measure. Default: all online cores. */
+/*  -MF : Mesh config F that places the cores. Default: koc cascade.     */
+/*  -oF : Write the calibrated mesh config to F. Default: mesh.conf      */
+/*  -wF : Write the measured latency matrix to F as CSV.                 */
+/*  -rR : R round trips per measurement. Default: 2000.                  */
+/*  -kK : K measurements per core pair, the median is used. Default: 5.  */
+/*  -d  : Discover the cha -> core map and capid6 by embedding the       */
+/*        latencies into the mesh grid instead of fitting a known map.   */
+/*        Measure one socket's cores only (-c).                          */
+/*  -CX : With -d, capid6 register value X (hex) if it is known.         */
+/*  -P  : With -d, resolve the mirror ambiguity of the embedding with    */
+/*        findCHAPerfCounter probing. Needs root and the msr module.     */
+/*  -h  : Print out command line options.                                */
+/*                                                                       */
+/*************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cha.hpp"
+#include "discovery.hpp"
+#include "latency.hpp"
+#include "topology.hpp"
+
+#define DEFAULT_ROUND_TRIPS     2000
+#define DEFAULT_REPETITIONS     5
+
+std::vector<int> parseCores(const std::string& text)
+{
+  std::vector<int> cores;
+  std::istringstream iss(text);
+  std::string core;
+  while (std::getline(iss, core, ',')) {
+    cores.push_back(atoi(core.c_str()));
+  }
+  return cores;
+}
+
+void writeLatencyMatrix(const std::string& filename, const std::vector<int>& cores,
+                        const std::vector<std::vector<double>>& latencies)
+{
+  std::ofstream outfile(filename);
+  outfile << "core";
+  for (int core : cores) {
+    outfile << ',' << core;
+  }
+  outfile << '\n';
+  for (size_t i = 0; i < cores.size(); i++) {
+    outfile << cores[i];
+    for (size_t j = 0; j < cores.size(); j++) {
+      outfile << ',' << latencies[i][j];
+    }
+    outfile << '\n';
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  long ch;
+  extern char *optarg;
+  std::vector<int> cores;
+  std::string mesh_in, mesh_out = "mesh.conf", matrix_out;
+  long round_trips = DEFAULT_ROUND_TRIPS;
+  long repetitions = DEFAULT_REPETITIONS;
+  long discover = 0;
+  long probe_cha = 0;
+  uint32_t capid6 = 0;
+
+  while ((ch = getopt(argc, argv, "c:M:o:w:r:k:C:dPh")) != -1) {
+    switch(ch) {
+    case 'c': cores = parseCores(optarg); break;
+    case 'M': mesh_in = optarg; break;
+    case 'o': mesh_out = optarg; break;
+    case 'w': matrix_out = optarg; break;
+    case 'r': round_trips = atoi(optarg); break;
+    case 'k': repetitions = atoi(optarg); break;
+    case 'd': discover = 1; break;
+    case 'C': capid6 = (uint32_t) strtoul(optarg, NULL, 16); break;
+    case 'P': probe_cha = 1; break;
+    case 'h': printf("Usage: calibrate <options>\n\n");
+              printf("options:\n");
+              printf("  -cC : Comma separated cores C to measure. Default: all online cores.\n");
+              printf("  -MF : Mesh config F that places the cores. Default: koc cascade.\n");
+              printf("  -oF : Write the calibrated mesh config to F. Default: mesh.conf\n");
+              printf("  -wF : Write the measured latency matrix to F as CSV.\n");
+              printf("  -rR : R round trips per measurement. Default: %d.\n", DEFAULT_ROUND_TRIPS);
+              printf("  -kK : K measurements per core pair, the median is used. Default: %d.\n", DEFAULT_REPETITIONS);
+              printf("  -d  : Discover the cha -> core map and capid6 from the latencies.\n");
+              printf("        Measure one socket's cores only (-c).\n");
+              printf("  -CX : With -d, capid6 register value X (hex) if it is known.\n");
+              printf("  -P  : With -d, resolve mirror ambiguity with findCHAPerfCounter probing.\n");
+              printf("  -h  : Print out command line options.\n\n");
+              exit(0);
+              break;
+    }
+  }
+
+  if (cores.empty()) {
+    for (int i = 0; i < getCoreCount(); i++) {
+      cores.push_back(i);
+    }
+  }
+  if (cores.size() < 2) {
+    fprintf(stderr, "ERROR: need at least two cores to measure.\n");
+    exit(-1);
+  }
+
+  MeshConfig config;
+  if (!mesh_in.empty() && !loadMeshConfig(mesh_in, config)) {
+    exit(-1);
+  }
+
+  printf("Measuring %zu cores, %ld round trips x %ld repetitions per pair.\n",
+         cores.size(), round_trips, repetitions);
+  const auto latencies = measureCoreToCoreLatency(cores, round_trips, repetitions);
+  if (!matrix_out.empty()) {
+    writeLatencyMatrix(matrix_out, cores, latencies);
+  }
+
+  if (discover) {
+    const auto result = discoverMesh(cores, latencies, capid6, probe_cha);
+    if (result.config.cha_core_map.empty()) {
+      fprintf(stderr, "ERROR: discovery failed.\n");
+      exit(-1);
+    }
+
+    printf("\n");
+    printf("                            DISCOVERY RESULTS\n");
+    printf("CAPID6                            :       0x%08x\n", result.config.capid6);
+    printf("Base latency (cycles)             : %16d\n", result.config.base_latency);
+    printf("Vertical hop cost (cycles)        : %16d\n", result.config.vertical_hop_cost);
+    printf("Horizontal hop cost (cycles)      : %16d\n", result.config.horizontal_hop_cost);
+    printf("RMS error (cycles)                : %16.2f\n", result.rms_error);
+    printf("Orientation resolved              : %16s\n", result.orientation_probed ? "yes" : "no");
+    printf("\n");
+    Topology(result.config).printTopology();
+
+    if (!saveMeshConfig(mesh_out, result.config)) {
+      exit(-1);
+    }
+    printf("Wrote mesh config %s.\n", mesh_out.c_str());
+    exit(0);
+  }
+
+  auto topo = Topology(config);
+  const auto fit = fitHopCosts(topo, cores, latencies);
+  if (fit.sample_count == 0) {
+    printf("None of the measured core pairs could be placed on the mesh, no fit possible.\n");
+    printf("Mesh config %s is not written.\n", mesh_out.c_str());
+    exit(0);
+  }
+
+  printf("\n");
+  printf("                            CALIBRATION RESULTS\n");
+  printf("Core pairs on the mesh            : %16d\n", fit.sample_count);
+  printf("Base latency (cycles)             : %16.2f\n", fit.base_latency);
+  printf("Vertical hop cost (cycles)        : %16.2f\n", fit.vertical_hop_cost);
+  printf("Horizontal hop cost (cycles)      : %16.2f\n", fit.horizontal_hop_cost);
+  printf("RMS error (cycles)                : %16.2f\n", fit.rms_error);
+  printf("\n");
+
+  /* Topology works with whole cycles. a hop is never free. */
+  config.base_latency = (int) lround(fit.base_latency);
+  config.vertical_hop_cost = (int) fmax(1.0, lround(fit.vertical_hop_cost));
+  config.horizontal_hop_cost = (int) fmax(1.0, lround(fit.horizontal_hop_cost));
+  if (!saveMeshConfig(mesh_out, config)) {
+    exit(-1);
+  }
+  printf("Wrote mesh config %s.\n", mesh_out.c_str());
+
+  exit(0);
+}
@@ -67,9 +67,8 @@ uintptr_t getPhysicalAddress(uintptr_t virtual_address) {
     return physical_address;
 }
 
-/// it is important to get the pointer by reference so that we do not copy it here! Has trouble while working with space
-/// allocated by mmap().
-int findCHAByHashing(uintptr_t virtual_address) {
+/// same slice hash as findCHAByHashing, for callers that already resolved the physical address (e.g. once per page).
+int findCHAByPhysicalAddress(uintptr_t physical_address) {
 static const std::vector<int> base_sequence{ // for 28 core SKX, CLX
     0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15, 17, 16, 19, 18, 21, 20, 23, 22, 25, 24, 27, 26, 1,
     16, 11, 18, 18, 19, 16, 17, 22, 23, 20, 21, 26, 27, 24, 25, 18, 3,  16, 9,  3,  2,  1,  0,  7,  6,  5,  4,  11, 10,
@@ -214,6 +213,19 @@ static const std::vector<int> base_sequence{ // for 28 core SKX, CLX
     3,  2,  1,  0,  12, 13, 14, 15, 8,  9,  10, 11, 4,  5,  6,  7,  0,  1,  2,  3,  13, 12, 7,  6,  25, 24, 27, 26, 21,
     20, 23, 22, 17, 16, 19, 18};
 
+    const auto computed_perm = compute_perm(physical_address);
+    const auto physical_address_index = getIndex(physical_address);
+    const auto base_sequence_index = computed_perm ^ physical_address_index;  /// XOR'ing.
+
+    // assert(base_sequence_index < 4096 && "Base sequence must be lower than 4096!");
+    const int cha_by_hashing = base_sequence[base_sequence_index];
+
+    return cha_by_hashing;
+}
+
+/// it is important to get the pointer by reference so that we do not copy it here! Has trouble while working with space
+/// allocated by mmap().
+int findCHAByHashing(uintptr_t virtual_address) {
     const pid_t pid = getpid();
     uintptr_t physical_address = 0;
 
@@ -225,14 +237,7 @@ static const std::vector<int> base_sequence{ // for 28 core SKX, CLX
         return EXIT_FAILURE;
     };
 
-    const auto computed_perm = compute_perm(physical_address);
-    const auto physical_address_index = getIndex(physical_address);
-    const auto base_sequence_index = computed_perm ^ physical_address_index;  /// XOR'ing.
-
-    // assert(base_sequence_index < 4096 && "Base sequence must be lower than 4096!");
-    const int cha_by_hashing = base_sequence[base_sequence_index];
-
-    return cha_by_hashing;
+    return findCHAByPhysicalAddress(physical_address);
 }
 
 /* Convert the given virtual address to physical using /proc/PID/pagemap.
@@ -336,7 +341,7 @@ int pagemap_get_entry(PagemapEntry *entry, int pagemap_fd, uintptr_t vaddr) {
     return 0;
 }
 
-static void stick_this_thread_to_core(int core_id) {
+void stick_this_thread_to_core(int core_id) {
     int num_cores = sysconf(_SC_NPROCESSORS_ONLN);
     if (core_id < 0 || core_id >= num_cores) {
         std::cerr << "error binding thread to core " << core_id << "\n";
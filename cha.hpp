@@ -15,10 +15,12 @@ struct PagemapEntry {
 uint64_t compute_perm(uintptr_t physical_address);
 uintptr_t getPhysicalAddress(uintptr_t virtual_address);
 int findCHAByHashing(uintptr_t virtual_address);
+int findCHAByPhysicalAddress(uintptr_t physical_address);
 int virt_to_phys_user(uintptr_t* paddr, pid_t pid, uintptr_t vaddr);
 uint64_t getIndex(uintptr_t physical_address);
 std::vector<int> readBaseSequence(const std::string& filename);
 int pagemap_get_entry(PagemapEntry* entry, int pagemap_fd, uintptr_t vaddr);
 
 int getCoreCount();
+void stick_this_thread_to_core(int core_id);
 std::pair<int, int> findCHAPerfCounter(long long* data);
\ No newline at end of file
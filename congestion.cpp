@@ -0,0 +1,164 @@
+#include "congestion.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+static constexpr auto MAX_REFINEMENT_ROUNDS = 64;
+
+CongestionModel::CongestionModel(Topology &topo) : topo_(topo) {}
+
+void CongestionModel::reset() { link_loads_.clear(); }
+
+void CongestionModel::addTransfer(const Transfer &transfer) {
+    const auto requester_tile = topo_.getTileByCore(transfer.requester_core);
+    const auto cha_tile = topo_.getTile(transfer.cha);
+    const auto forwarder_tile = topo_.getTileByCore(transfer.forwarder_core);
+
+    if (requester_tile.x == UNDEFINED || cha_tile.x == UNDEFINED || forwarder_tile.x == UNDEFINED) {
+        // core or cha is not on this die (e.g. other socket). nothing to route.
+        return;
+    }
+
+    // same three legs as Topology::getHopCost(requesting_core, forwarder_core, coherence_cha).
+    route(requester_tile, cha_tile, transfer.weight);
+    route(cha_tile, forwarder_tile, transfer.weight);
+    route(forwarder_tile, requester_tile, transfer.weight);
+}
+
+void CongestionModel::addTransfers(const std::vector<Transfer> &transfers) {
+    for (const auto &transfer : transfers) {
+        addTransfer(transfer);
+    }
+}
+
+// dimension ordered YX routing as done by the SKX mesh: first travel vertically to the destination row, then
+// horizontally to the destination column. keep in mind that x signifies vertical axis here.
+void CongestionModel::route(const Tile &src, const Tile &dst, long weight) {
+    int x = src.x;
+    int y = src.y;
+
+    while (x != dst.x) {
+        const int next_x = x + (dst.x > x ? 1 : -1);
+        link_loads_[{x, y, next_x, y}] += weight;
+        x = next_x;
+    }
+    while (y != dst.y) {
+        const int next_y = y + (dst.y > y ? 1 : -1);
+        link_loads_[{x, y, x, next_y}] += weight;
+        y = next_y;
+    }
+}
+
+int CongestionModel::getLinkCost(const MeshLink &link) const {
+    return link.from_x != link.to_x ? topo_.getVerticalHopCost() : topo_.getHorizontalHopCost();
+}
+
+long CongestionModel::getMaxLinkLoad() const {
+    long max_load = 0;
+    for (const auto &[link, load] : link_loads_) {
+        max_load = std::max(max_load, load);
+    }
+    return max_load;
+}
+
+// what getHopCost would report summed over all transfers, i.e. congestion is ignored.
+long CongestionModel::getTotalHopCost() const {
+    long cost = 0;
+    for (const auto &[link, load] : link_loads_) {
+        cost += load * getLinkCost(link);
+    }
+    return cost;
+}
+
+// every traversal of a link is charged (1 + load / mean_load) times its hop cost, so links that carry more than the
+// average traffic get proportionally more expensive. this is a crude queueing approximation, good enough to rank
+// mappings against each other.
+double CongestionModel::getCongestionAdjustedCost() const {
+    if (link_loads_.empty()) {
+        return 0.0;
+    }
+
+    double total_load = 0;
+    for (const auto &[link, load] : link_loads_) {
+        total_load += load;
+    }
+    const double mean_load = total_load / link_loads_.size();
+
+    double cost = 0.0;
+    for (const auto &[link, load] : link_loads_) {
+        cost += load * getLinkCost(link) * (1.0 + load / mean_load);
+    }
+    return cost;
+}
+
+std::vector<std::pair<MeshLink, long>> CongestionModel::getHotspotLinks(int count) const {
+    std::vector<std::pair<MeshLink, long>> links(link_loads_.begin(), link_loads_.end());
+    std::sort(links.begin(), links.end(), [](const auto &lhs, const auto &rhs) { return lhs.second > rhs.second; });
+    if (links.size() > count) {
+        links.resize(count);
+    }
+    return links;
+}
+
+void CongestionModel::printReport(const char *name, int hotspot_count) const {
+    std::cout << name << " mapping. total hop cost: " << getTotalHopCost()
+              << ", congestion adjusted cost: " << getCongestionAdjustedCost()
+              << ", max link load: " << getMaxLinkLoad() << ", used links: " << link_loads_.size() << std::endl;
+
+    for (const auto &[link, load] : getHotspotLinks(hotspot_count)) {
+        std::cout << "  hotspot link (" << link.from_x << ", " << link.from_y << ") -> (" << link.to_x << ", "
+                  << link.to_y << ") load: " << load << std::endl;
+    }
+}
+
+// every (freq, cha, t1, t2) entry becomes two transfers since both threads of the pair write the shared lines.
+std::vector<Transfer> buildTransfers(const CommunicationProfile &profile, const std::vector<int> &thread_to_core) {
+    std::vector<Transfer> transfers;
+    transfers.reserve(profile.size() * 2);
+
+    for (const auto &[freq, cha, t1, t2] : profile) {
+        assert(t1 < thread_to_core.size() && t2 < thread_to_core.size());
+        transfers.push_back({thread_to_core[t1], cha, thread_to_core[t2], freq});
+        transfers.push_back({thread_to_core[t2], cha, thread_to_core[t1], freq});
+    }
+
+    return transfers;
+}
+
+static std::pair<long, double> evaluateMapping(CongestionModel &model, const CommunicationProfile &profile,
+                                               const std::vector<int> &thread_to_core) {
+    model.reset();
+    model.addTransfers(buildTransfers(profile, thread_to_core));
+    return {model.getMaxLinkLoad(), model.getCongestionAdjustedCost()};
+}
+
+void minimizeMaxLinkLoad(Topology &topo, const CommunicationProfile &profile, std::vector<int> &thread_to_core) {
+    CongestionModel model(topo);
+    auto best = evaluateMapping(model, profile, thread_to_core);
+
+    for (int round = 0; round < MAX_REFINEMENT_ROUNDS; ++round) {
+        bool improved = false;
+
+        for (int t1 = 0; t1 < thread_to_core.size(); ++t1) {
+            for (int t2 = t1 + 1; t2 < thread_to_core.size(); ++t2) {
+                std::swap(thread_to_core[t1], thread_to_core[t2]);
+                const auto candidate = evaluateMapping(model, profile, thread_to_core);
+
+                if (candidate < best) {  // max link load first, adjusted cost breaks ties.
+                    best = candidate;
+                    improved = true;
+                } else {
+                    std::swap(thread_to_core[t1], thread_to_core[t2]);  // undo.
+                }
+            }
+        }
+
+        if (!improved) {
+            break;
+        }
+    }
+
+    std::cout << "link load refinement done. max link load: " << best.first
+              << ", congestion adjusted cost: " << best.second << std::endl;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "topology.hpp"
+
+// directed link between two neighbouring tiles of the mesh. x is on vertical axis, y is on horizontal axis.
+struct MeshLink {
+    int from_x = UNDEFINED;
+    int from_y = UNDEFINED;
+    int to_x = UNDEFINED;
+    int to_y = UNDEFINED;
+
+    bool operator<(const MeshLink& other) const {
+        return std::tie(from_x, from_y, to_x, to_y) < std::tie(other.from_x, other.from_y, other.to_x, other.to_y);
+    }
+};
+
+// a single coherence transaction: requester asks the home cha, which forwards the line to the forwarder, which in
+// turn sends the data back to the requester. weight is how many times the transaction happens.
+struct Transfer {
+    int requester_core = UNDEFINED;
+    int cha = UNDEFINED;
+    int forwarder_core = UNDEFINED;
+    long weight = 0;
+};
+
+// (freq, cha, t1, t2) tuples as produced by the address tracking pass in main.
+using CommunicationProfile = std::multiset<std::tuple<int, int, int, int>, std::greater<>>;
+
+class CongestionModel {
+   public:
+    explicit CongestionModel(Topology& topo);
+    void reset();
+    void addTransfer(const Transfer& transfer);
+    void addTransfers(const std::vector<Transfer>& transfers);
+    long getMaxLinkLoad() const;
+    long getTotalHopCost() const;
+    double getCongestionAdjustedCost() const;
+    std::vector<std::pair<MeshLink, long>> getHotspotLinks(int count) const;
+    void printReport(const char* name, int hotspot_count = 5) const;
+
+   private:
+    void route(const Tile& src, const Tile& dst, long weight);
+    int getLinkCost(const MeshLink& link) const;
+
+    Topology& topo_;
+    std::map<MeshLink, long> link_loads_;
+};
+
+std::vector<Transfer> buildTransfers(const CommunicationProfile& profile, const std::vector<int>& thread_to_core);
+
+// swaps thread pairs of thread_to_core as long as the maximum link load (then the congestion adjusted cost) drops.
+void minimizeMaxLinkLoad(Topology& topo, const CommunicationProfile& profile, std::vector<int>& thread_to_core);
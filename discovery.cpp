@@ -0,0 +1,304 @@
+#include "discovery.hpp"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <set>
+#include <utility>
+
+#include "cha.hpp"
+
+static constexpr auto RESTART_COUNT = 16;
+static constexpr auto REFIT_ROUNDS = 8;
+static constexpr auto PROBE_LINE_CANDIDATES = 64;
+static constexpr auto PROBE_CHA_COUNT = 4;
+static constexpr auto PROBE_ITERATIONS = 1000;
+
+using Position = std::pair<int, int>;  // (x, y) of a tile.
+
+struct HopModel {
+    double base = 0.0;
+    double vertical = 1.0;
+    double horizontal = 1.0;
+
+    double predict(const Position &a, const Position &b) const {
+        return base + vertical * std::abs(a.first - b.first) + horizontal * std::abs(a.second - b.second);
+    }
+};
+
+// core placement candidates: every tile that is not an IMC and, if capid6 is known, enabled.
+static std::vector<Position> getCandidatePositions(std::uint32_t capid6) {
+    auto topo = Topology(std::map<int, int>{}, capid6 == 0 ? 0xffffffff : capid6);
+
+    std::vector<Position> positions;
+    for (int x = 0; x < topo.getRowCount(); ++x) {
+        for (int y = 0; y < topo.getColCount(); ++y) {
+            if (topo.getTile(x, y).cha != UNDEFINED) {
+                positions.emplace_back(x, y);
+            }
+        }
+    }
+    return positions;
+}
+
+// capid6 and cha numbering follow from which tiles hold a core, chas are numbered by Topology.
+static MeshConfig buildMeshConfig(const std::vector<int> &cores, const std::vector<Position> &placement,
+                                  std::uint32_t capid6) {
+    MeshConfig config;
+    config.capid6 = capid6 != 0 ? capid6 : Topology::buildCapid6(placement);
+    config.cha_core_map.clear();
+
+    auto topo = Topology(std::map<int, int>{}, config.capid6);
+    for (int c = 0; c < cores.size(); ++c) {
+        const auto tile = topo.getTile(placement[c].first, placement[c].second);
+        assert(tile.cha != UNDEFINED);
+        config.cha_core_map[tile.cha] = cores[c];
+    }
+    return config;
+}
+
+static double getCoreCost(int c, const std::vector<Position> &placement,
+                          const std::vector<std::vector<double>> &latencies, const HopModel &model) {
+    double cost = 0.0;
+    for (int d = 0; d < placement.size(); ++d) {
+        if (d != c) {
+            const double residual = latencies[c][d] - model.predict(placement[c], placement[d]);
+            cost += residual * residual;
+        }
+    }
+    return cost;
+}
+
+static double getTotalCost(const std::vector<Position> &placement, const std::vector<std::vector<double>> &latencies,
+                           const HopModel &model) {
+    double cost = 0.0;
+    for (int c = 0; c < placement.size(); ++c) {
+        cost += getCoreCost(c, placement, latencies, model);
+    }
+    return cost / 2;  // every pair was counted twice.
+}
+
+// first improvement local search over "swap two cores" and "move a core to a free tile".
+static void improvePlacement(std::vector<Position> &placement, const std::vector<Position> &positions,
+                             const std::vector<std::vector<double>> &latencies, const HopModel &model) {
+    bool improved = true;
+    while (improved) {
+        improved = false;
+
+        for (int c = 0; c < placement.size(); ++c) {
+            for (int d = c + 1; d < placement.size(); ++d) {
+                const double before = getCoreCost(c, placement, latencies, model) +
+                                      getCoreCost(d, placement, latencies, model);
+                std::swap(placement[c], placement[d]);
+                const double after = getCoreCost(c, placement, latencies, model) +
+                                     getCoreCost(d, placement, latencies, model);
+                if (after < before - 1e-9) {
+                    improved = true;
+                } else {
+                    std::swap(placement[c], placement[d]);
+                }
+            }
+
+            const std::set<Position> occupied(placement.begin(), placement.end());
+            for (const auto &position : positions) {
+                if (occupied.count(position)) {
+                    continue;
+                }
+                const double before = getCoreCost(c, placement, latencies, model);
+                const auto old_position = placement[c];
+                placement[c] = position;
+                if (getCoreCost(c, placement, latencies, model) < before - 1e-9) {
+                    improved = true;
+                    break;
+                }
+                placement[c] = old_position;
+            }
+        }
+    }
+}
+
+static HopModel refitModel(const std::vector<int> &cores, const std::vector<Position> &placement,
+                           const std::vector<std::vector<double>> &latencies, std::uint32_t capid6,
+                           const HopModel &fallback) {
+    auto topo = Topology(buildMeshConfig(cores, placement, capid6));
+    const auto fit = fitHopCosts(topo, cores, latencies);
+    if (fit.sample_count == 0) {
+        return fallback;
+    }
+    return {fit.base_latency, fit.vertical_hop_cost, fit.horizontal_hop_cost};
+}
+
+// all mirror images of the placement that land on candidate tiles only.
+static std::vector<std::vector<Position>> getMirrorImages(const std::vector<Position> &placement,
+                                                          const std::vector<Position> &positions, int rows,
+                                                          int cols) {
+    const std::set<Position> valid(positions.begin(), positions.end());
+    std::vector<std::vector<Position>> images;
+
+    for (int flip_x = 0; flip_x < 2; ++flip_x) {
+        for (int flip_y = 0; flip_y < 2; ++flip_y) {
+            std::vector<Position> image;
+            for (const auto &[x, y] : placement) {
+                const Position mirrored{flip_x ? rows - 1 - x : x, flip_y ? cols - 1 - y : y};
+                if (!valid.count(mirrored)) {
+                    break;
+                }
+                image.push_back(mirrored);
+            }
+            if (image.size() == placement.size()) {
+                images.push_back(image);
+            }
+        }
+    }
+    return images;
+}
+
+static bool canAccessMsrs() {
+    const int fd = open("/dev/cpu/0/msr", O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+// picks the mirror image whose predicted core -> cha distances correlate best with flush+reload latencies.
+static int probeOrientation(const std::vector<int> &cores, const std::vector<std::vector<Position>> &images,
+                            std::uint32_t capid6) {
+    long long *buffer = nullptr;
+    const int ret = posix_memalign(reinterpret_cast<void **>(&buffer), 4096, PROBE_LINE_CANDIDATES * 4096);
+    assert(ret == 0);
+
+    // one probe line per cha, lines on separate pages to get different hash inputs.
+    std::map<int, long long *> probe_lines;
+    for (int i = 0; i < PROBE_LINE_CANDIDATES && probe_lines.size() < PROBE_CHA_COUNT; ++i) {
+        long long *line = buffer + i * 4096 / sizeof(long long);
+        line[0] = i;  // make sure the page is backed.
+        const auto [socket, cha] = findCHAPerfCounter(line);
+        if (cha >= 0 && !probe_lines.count(cha)) {
+            probe_lines[cha] = line;
+        }
+    }
+    std::cout << "probing orientation with " << probe_lines.size() << " lines of distinct chas." << std::endl;
+
+    // latency[line][core], centered per line so that the cha -> memory part cancels out.
+    std::vector<std::vector<double>> measured;
+    for (const auto &[cha, line] : probe_lines) {
+        std::vector<double> row;
+        for (const auto core : cores) {
+            row.push_back(measureFlushReloadLatency(core, line, PROBE_ITERATIONS));
+        }
+        measured.push_back(row);
+    }
+
+    int best_image = 0;
+    double best_score = -std::numeric_limits<double>::infinity();
+    for (int i = 0; i < images.size(); ++i) {
+        auto topo = Topology(buildMeshConfig(cores, images[i], capid6));
+
+        double score = 0.0;
+        int l = 0;
+        for (const auto &[cha, line] : probe_lines) {
+            std::vector<double> predicted;
+            for (const auto core : cores) {
+                predicted.push_back(topo.getHopCost(core, cha));
+            }
+
+            double mean_m = 0.0, mean_p = 0.0;
+            for (int c = 0; c < cores.size(); ++c) {
+                mean_m += measured[l][c] / cores.size();
+                mean_p += predicted[c] / cores.size();
+            }
+            for (int c = 0; c < cores.size(); ++c) {
+                score += (measured[l][c] - mean_m) * (predicted[c] - mean_p);
+            }
+            ++l;
+        }
+
+        std::cout << "orientation " << i << " correlation score: " << score << std::endl;
+        if (score > best_score) {
+            best_score = score;
+            best_image = i;
+        }
+    }
+
+    free(buffer);
+    return best_image;
+}
+
+DiscoveryResult discoverMesh(const std::vector<int> &cores, const std::vector<std::vector<double>> &latencies,
+                             std::uint32_t capid6, bool probe_cha) {
+    const auto positions = getCandidatePositions(capid6);
+    DiscoveryResult result;
+
+    if (cores.size() > positions.size() || (capid6 != 0 && cores.size() != positions.size())) {
+        std::cerr << cores.size() << " cores do not fit the " << positions.size() << " candidate tiles.\n";
+        return result;
+    }
+
+    // initial guess: closest pair is one hop, cost split evenly between directions.
+    double min_latency = std::numeric_limits<double>::infinity();
+    double mean_latency = 0.0;
+    for (int c = 0; c < cores.size(); ++c) {
+        for (int d = c + 1; d < cores.size(); ++d) {
+            min_latency = std::min(min_latency, latencies[c][d]);
+            mean_latency += latencies[c][d] * 2 / (cores.size() * (cores.size() - 1));
+        }
+    }
+    const double hop_guess = std::max(1.0, (mean_latency - min_latency) / 3);
+    const HopModel initial_model{min_latency - hop_guess, hop_guess, hop_guess};
+
+    std::mt19937 rng(1);
+    std::vector<Position> best_placement;
+    HopModel best_model;
+    double best_cost = std::numeric_limits<double>::infinity();
+
+    for (int restart = 0; restart < RESTART_COUNT; ++restart) {
+        auto shuffled = positions;
+        std::shuffle(shuffled.begin(), shuffled.end(), rng);
+        std::vector<Position> placement(shuffled.begin(), shuffled.begin() + cores.size());
+
+        auto model = initial_model;
+        for (int round = 0; round < REFIT_ROUNDS; ++round) {
+            improvePlacement(placement, positions, latencies, model);
+            model = refitModel(cores, placement, latencies, capid6, model);
+        }
+
+        const double cost = getTotalCost(placement, latencies, model);
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_placement = placement;
+            best_model = model;
+        }
+    }
+
+    auto topo = Topology(std::map<int, int>{}, 0xffffffff);
+    const auto images = getMirrorImages(best_placement, positions, topo.getRowCount(), topo.getColCount());
+    int chosen = 0;
+    if (images.size() > 1) {
+        if (probe_cha && canAccessMsrs()) {
+            chosen = probeOrientation(cores, images, capid6);
+            result.orientation_probed = true;
+        } else {
+            std::cout << images.size() << " mirror images explain the latencies equally well, picking the first. "
+                      << "run as root with the msr module loaded and probing enabled to resolve this." << std::endl;
+        }
+    } else {
+        result.orientation_probed = true;  // nothing to resolve.
+    }
+
+    result.config = buildMeshConfig(cores, images[chosen], capid6);
+    result.config.base_latency = static_cast<int>(std::lround(best_model.base));
+    result.config.vertical_hop_cost = std::max(1, static_cast<int>(std::lround(best_model.vertical)));
+    result.config.horizontal_hop_cost = std::max(1, static_cast<int>(std::lround(best_model.horizontal)));
+    result.rms_error = std::sqrt(best_cost / (cores.size() * (cores.size() - 1) / 2));
+
+    return result;
+}
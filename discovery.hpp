@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "latency.hpp"
+#include "topology.hpp"
+
+struct DiscoveryResult {
+    MeshConfig config;                // capid6, cha -> core map and fitted hop costs.
+    double rms_error = 0.0;           // how well the hop model explains the measured latencies with this placement.
+    bool orientation_probed = false;  // false if the mirror ambiguity of the embedding could not be resolved.
+};
+
+// embeds the cores into the mesh grid so that base + vertical * |dx| + horizontal * |dy| matches the measured core to
+// core latencies best. a capid6 of 0 means the enabled tiles are unknown and get derived from the placement as well.
+// latencies alone cannot tell a placement from its mirror image, so with probe_cha set the home cha of a few lines is
+// found with findCHAPerfCounter (MSR access needed) and flush+reload latencies from every core pick the orientation.
+DiscoveryResult discoverMesh(const std::vector<int>& cores, const std::vector<std::vector<double>>& latencies,
+                             std::uint32_t capid6, bool probe_cha);
@@ -0,0 +1,89 @@
+#include "elastic.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+// trailing updates a thread should get per step before the team halves.
+static constexpr auto MIN_UPDATES_PER_THREAD = 4;
+// l2 of a cascade lake core, used if sysconf does not know.
+static constexpr long DEFAULT_L2_SIZE = 1024 * 1024;
+
+std::vector<long> getElasticTeamSizes(long n, long block_size, long thread_count) {
+    const long nblocks = (n + block_size - 1) / block_size;
+    long l2_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2_size <= 0) {
+        l2_size = DEFAULT_L2_SIZE;
+    }
+
+    // step 0 always has the full team, so no run is single threaded from the start.
+    std::vector<long> sizes(nblocks, thread_count);
+    long size = thread_count;
+    for (long K = 1; K < nblocks; ++K) {
+        const long remaining = std::max(0L, n - (K + 1) * block_size);  // the trailing matrix step K updates.
+        const long updates = (nblocks - K - 1) * (nblocks - K - 1);
+        if (remaining * remaining * static_cast<long>(sizeof(double)) <= l2_size) {
+            size = 1;
+        }
+        while (size > 1 && updates < size * MIN_UPDATES_PER_THREAD) {
+            size /= 2;
+        }
+        sizes[K] = size;
+    }
+    return sizes;
+}
+
+std::vector<long> orderThreadsByChaCost(Topology& topo, const std::vector<int>& thread_to_core,
+                                        const std::map<int, int>& histogram) {
+    std::vector<std::pair<long, long>> costs;  // (cost, thread)
+    for (long thread = 0; thread < thread_to_core.size(); ++thread) {
+        long cost = 0;
+        for (const auto& [cha, count] : histogram) {
+            cost += count * topo.getHopCost(thread_to_core[thread], cha);
+        }
+        costs.emplace_back(cost, thread);
+    }
+    std::stable_sort(costs.begin(), costs.end());
+
+    std::vector<long> order;
+    for (const auto& cost : costs) {
+        order.push_back(cost.second);
+    }
+    return order;
+}
+
+ElasticTeam::ElasticTeam(const std::vector<long>& sizes, const std::vector<long>& order, BarrierKind kind,
+                         Topology& topo, const std::vector<int>& thread_to_core)
+    : sizes_(sizes), order_(order), ranks_(order.size()) {
+    for (long rank = 0; rank < order_.size(); ++rank) {
+        ranks_[order_[rank]] = rank;
+    }
+    for (const auto size : sizes_) {
+        if (size == 1 || barriers_.count(size) > 0) {
+            continue;
+        }
+        auto& barrier = barriers_[size];
+        if (kind == BarrierKind::Tree) {
+            std::vector<int> cores;
+            for (long rank = 0; rank < size; ++rank) {
+                cores.push_back(thread_to_core[order_[rank]]);
+            }
+            barrier.tree = std::make_unique<TreeBarrier>(topo, cores);
+        } else {
+            barrier.condvar = std::make_unique<CondvarBarrier>(size);
+        }
+    }
+}
+
+void ElasticTeam::wait(long thread, long K) {
+    const long size = sizes_[K];
+    if (size == 1) {
+        return;
+    }
+    auto& barrier = barriers_.at(size);
+    if (barrier.tree) {
+        barrier.tree->wait(ranks_[thread]);
+    } else {
+        barrier.condvar->wait();
+    }
+}
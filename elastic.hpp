@@ -0,0 +1,45 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "barrier.hpp"
+#include "topology.hpp"
+
+// team size of every step K of an n x n factorization in blocks of block_size on up to thread_count threads. the team
+// halves whenever the trailing update would give its threads fewer than a few blocks each, and a single thread takes
+// over once the trailing matrix of the step fits into its l2. step 0 always has all thread_count threads.
+std::vector<long> getElasticTeamSizes(long n, long block_size, long thread_count);
+
+// threads by the line weighted hop cost from their core to the chas in histogram, the cheapest first.
+std::vector<long> orderThreadsByChaCost(Topology& topo, const std::vector<int>& thread_to_core,
+                                        const std::map<int, int>& histogram);
+
+// the shrinking team of the barrier schedule with -e. the team of step K is the first getTeamSize(K) threads of order,
+// the others are parked for the rest of the run. every team size has its own barrier, so that parked threads can wait
+// on the full one meanwhile.
+class ElasticTeam {
+public:
+    // sizes from getElasticTeamSizes, order a permutation of the threads. thread_to_core shapes the tree barriers.
+    ElasticTeam(const std::vector<long>& sizes, const std::vector<long>& order, BarrierKind kind, Topology& topo,
+                const std::vector<int>& thread_to_core);
+
+    long getTeamSize(long K) const { return sizes_[K]; }
+    long getMember(long rank) const { return order_[rank]; }
+    bool isActive(long thread, long K) const { return ranks_[thread] < sizes_[K]; }
+
+    // the barrier of the team of step K.
+    void wait(long thread, long K);
+
+private:
+    struct TeamBarrier {
+        std::unique_ptr<CondvarBarrier> condvar;
+        std::unique_ptr<TreeBarrier> tree;
+    };
+
+    std::vector<long> sizes_;
+    std::vector<long> order_;
+    std::vector<long> ranks_;  // [thread]: position in order_.
+    std::map<long, TeamBarrier> barriers_;
+};
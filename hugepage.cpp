@@ -0,0 +1,202 @@
+#include "hugepage.hpp"
+
+#include <sys/mman.h>
+#include <stdlib.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "perf_events.hpp"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+static constexpr std::size_t PAGE_SIZE = 4096;
+static constexpr std::size_t HUGE_PAGE_SIZE_2M = 2ul * 1024 * 1024;
+static constexpr std::size_t HUGE_PAGE_SIZE_1G = 1024ul * 1024 * 1024;
+static constexpr auto SWEEP_ROUNDS = 4;
+
+static std::size_t roundUp(std::size_t size, std::size_t page_size) {
+    return (size + page_size - 1) / page_size * page_size;
+}
+
+static std::string formatSize(std::size_t bytes) {
+    std::ostringstream out;
+    if (bytes >= HUGE_PAGE_SIZE_1G && bytes % HUGE_PAGE_SIZE_1G == 0) {
+        out << bytes / HUGE_PAGE_SIZE_1G << " GiB";
+    } else if (bytes >= 1024 * 1024) {
+        out << bytes / (1024 * 1024) << " MiB";
+    } else {
+        out << bytes / 1024 << " KiB";
+    }
+    return out.str();
+}
+
+bool parsePageMode(const std::string& name, PageMode& mode) {
+    if (name == "4k") {
+        mode = PageMode::Default;
+    } else if (name == "thp") {
+        mode = PageMode::Thp;
+    } else if (name == "2m") {
+        mode = PageMode::Huge2M;
+    } else if (name == "1g") {
+        mode = PageMode::Huge1G;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool mapHugetlb(std::size_t size, std::size_t page_size, int page_shift, bool prefault,
+                       PageAllocation& allocation) {
+    const std::size_t mapped_size = roundUp(size, page_size);
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (page_shift << MAP_HUGE_SHIFT);
+    // hugetlb pages are reserved by mmap even without MAP_POPULATE, so a missing pool still fails here.
+    void* address = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, flags | (prefault ? MAP_POPULATE : 0), -1, 0);
+    if (address == MAP_FAILED) {
+        std::cout << "no " << formatSize(page_size) << " hugetlb pages available for " << formatSize(mapped_size)
+                  << ", falling back." << std::endl;
+        return false;
+    }
+
+    allocation.address = address;
+    allocation.size = mapped_size;
+    allocation.page_size = page_size;
+    allocation.mapped = true;
+    return true;
+}
+
+PageAllocation allocatePages(std::size_t size, PageMode mode, bool prefault) {
+    PageAllocation allocation;
+
+    bool done = false;
+    if (mode == PageMode::Huge1G) {
+        done = mapHugetlb(size, HUGE_PAGE_SIZE_1G, 30, prefault, allocation);
+    }
+    if (!done && (mode == PageMode::Huge1G || mode == PageMode::Huge2M)) {
+        done = mapHugetlb(size, HUGE_PAGE_SIZE_2M, 21, prefault, allocation);
+    }
+
+    if (!done) {
+        // thp only collapses 2 MiB aligned ranges.
+        const bool thp = mode != PageMode::Default;
+        const std::size_t alignment = thp ? HUGE_PAGE_SIZE_2M : PAGE_SIZE;
+        allocation.size = roundUp(size, alignment);
+        if (posix_memalign(&allocation.address, alignment, allocation.size) != 0) {
+            std::cerr << "could not allocate " << formatSize(allocation.size) << ".\n";
+            exit(EXIT_FAILURE);
+        }
+        allocation.page_size = PAGE_SIZE;
+        if (thp) {
+            allocation.thp = madvise(allocation.address, allocation.size, MADV_HUGEPAGE) == 0;
+            if (!allocation.thp) {
+                std::cout << "transparent huge pages are not available, using 4 KiB pages." << std::endl;
+            }
+        }
+        if (prefault) {
+            std::memset(allocation.address, 0, allocation.size);  // hugetlb mappings are populated by mmap.
+        }
+    }
+
+    return allocation;
+}
+
+void lockPages(PageAllocation& allocation) {
+    allocation.locked = mlock(allocation.address, allocation.size) == 0;
+    if (!allocation.locked) {
+        std::cout << "could not mlock " << formatSize(allocation.size) << ": " << strerror(errno) << std::endl;
+    }
+}
+
+void freePages(PageAllocation& allocation) {
+    if (allocation.address == nullptr) {
+        return;
+    }
+    if (allocation.locked) {
+        munlock(allocation.address, allocation.size);
+    }
+    if (allocation.mapped) {
+        munmap(allocation.address, allocation.size);
+    } else {
+        free(allocation.address);
+    }
+    allocation = PageAllocation();
+}
+
+// AnonHugePages of every /proc/self/smaps mapping that overlaps the allocation.
+static std::size_t getThpBytes(const PageAllocation& allocation) {
+    const auto first = reinterpret_cast<std::uintptr_t>(allocation.address);
+    const auto last = first + allocation.size;
+
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool overlaps = false;
+    std::size_t bytes = 0;
+    while (std::getline(smaps, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+
+        const auto dash = key.find('-');
+        if (dash != std::string::npos && key.back() != ':') {
+            const auto start = std::stoul(key.substr(0, dash), nullptr, 16);
+            const auto end = std::stoul(key.substr(dash + 1), nullptr, 16);
+            overlaps = start < last && end > first;
+        } else if (overlaps && key == "AnonHugePages:") {
+            std::size_t kilobytes = 0;
+            fields >> kilobytes;
+            bytes += kilobytes * 1024;
+        }
+    }
+    return bytes;
+}
+
+void printPageReport(const char* name, const PageAllocation& allocation) {
+    std::cout << name << ": " << formatSize(allocation.size) << " on ";
+    if (allocation.page_size > PAGE_SIZE) {
+        std::cout << formatSize(allocation.page_size) << " hugetlb pages";
+    } else if (allocation.thp) {
+        std::cout << "thp, " << formatSize(getThpBytes(allocation)) << " of it in 2 MiB pages";
+    } else {
+        std::cout << "4 KiB pages";
+    }
+    std::cout << (allocation.locked ? ", mlocked." : ".") << std::endl;
+}
+
+static long long sweepPages(TlbMissCounter& counter, const char* address, std::size_t size) {
+    volatile char sink = 0;
+    counter.start();
+    for (int round = 0; round < SWEEP_ROUNDS; ++round) {
+        for (std::size_t offset = 0; offset < size; offset += PAGE_SIZE) {
+            sink = sink + address[offset];
+        }
+    }
+    return counter.stop();
+}
+
+void printTlbMissDifference(const PageAllocation& allocation) {
+    TlbMissCounter counter;
+    if (!counter.isAvailable()) {
+        std::cout << "dTLB miss counters are not available (perf_event_paranoid?)." << std::endl;
+        return;
+    }
+
+    void* reference = nullptr;
+    if (posix_memalign(&reference, PAGE_SIZE, allocation.size) != 0) {
+        return;
+    }
+    madvise(reference, allocation.size, MADV_NOHUGEPAGE);
+    std::memset(reference, 0, allocation.size);
+
+    const auto misses = sweepPages(counter, static_cast<const char*>(allocation.address), allocation.size);
+    const auto reference_misses = sweepPages(counter, static_cast<const char*>(reference), allocation.size);
+    free(reference);
+
+    std::cout << "dTLB misses of a page strided sweep: " << misses << " (4 KiB pages: " << reference_misses
+              << ", difference: " << reference_misses - misses << ")" << std::endl;
+}
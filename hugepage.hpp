@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Default keeps the 4 KiB pages of posix_memalign. the others are tried in the order 1g -> 2m -> thp -> 4 KiB until
+// one succeeds.
+enum class PageMode { Default, Thp, Huge2M, Huge1G };
+
+// "4k", "thp", "2m" or "1g".
+bool parsePageMode(const std::string& name, PageMode& mode);
+
+struct PageAllocation {
+    void* address = nullptr;
+    std::size_t size = 0;       // bytes mapped, rounded up to page_size.
+    std::size_t page_size = 0;  // hugetlb page size, 4096 for thp and plain pages.
+    bool mapped = false;        // munmap instead of free.
+    bool thp = false;
+    bool locked = false;
+};
+
+// maps at least size bytes with the requested page size. without prefault the pages are left for a parallel first
+// touch.
+PageAllocation allocatePages(std::size_t size, PageMode mode, bool prefault);
+// mlock keeps the physical layout put between the tracking pass and the timed runs. faults in what is left.
+void lockPages(PageAllocation& allocation);
+void freePages(PageAllocation& allocation);
+
+// page sizes that actually back the allocation, thp coverage read from /proc/self/smaps.
+void printPageReport(const char* name, const PageAllocation& allocation);
+
+// dTLB misses of a page strided sweep over the allocation and over a plain 4 KiB page buffer of the same size.
+void printTlbMissDifference(const PageAllocation& allocation);
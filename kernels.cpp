@@ -0,0 +1,569 @@
+#include "kernels.hpp"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+// cache blocking: a kc x nc panel of b stays in l2, a mc x kc panel of a in l1/l2 while the micro kernel sweeps it.
+static constexpr long GEMM_KC = 256;
+static constexpr long GEMM_MC = 128;
+static constexpr long GEMM_NC = 512;
+
+// micro kernel: c[0:m, 0:n] -= packed_a * packed_b over kc steps. packed_a holds mr rows per step, packed_b nr
+// columns per step, both zero padded. m <= mr and n <= nr are the valid part of the tile.
+using MicroKernel = void (*)(long kc, const double* packed_a, const double* packed_b, double* c, long ldc, long m,
+                             long n);
+
+struct MicroKernelShape {
+    long mr;
+    long nr;
+    MicroKernel run;
+};
+
+bool isKernelBackendSupported(KernelBackend backend) {
+    __builtin_cpu_init();
+    switch (backend) {
+        case KernelBackend::Scalar:
+            return true;
+        case KernelBackend::Avx2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case KernelBackend::Avx512:
+            return __builtin_cpu_supports("avx512f");
+    }
+    return false;
+}
+
+KernelBackend detectKernelBackend() {
+    for (const auto backend : {KernelBackend::Avx512, KernelBackend::Avx2}) {
+        if (isKernelBackendSupported(backend)) {
+            return backend;
+        }
+    }
+    return KernelBackend::Scalar;
+}
+
+const char* getKernelBackendName(KernelBackend backend) {
+    switch (backend) {
+        case KernelBackend::Scalar:
+            return "scalar";
+        case KernelBackend::Avx2:
+            return "avx2";
+        case KernelBackend::Avx512:
+            return "avx512";
+    }
+    return "unknown";
+}
+
+bool parseKernelBackend(const std::string& name, KernelBackend& backend) {
+    if (name == "scalar") {
+        backend = KernelBackend::Scalar;
+    } else if (name == "avx2") {
+        backend = KernelBackend::Avx2;
+    } else if (name == "avx512") {
+        backend = KernelBackend::Avx512;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// subtracts a finished mr x nr tile, only its valid part at the edges.
+static void subtractTile(const double* tile, long mr, double* c, long ldc, long m, long n) {
+    for (long j = 0; j < n; ++j) {
+        for (long i = 0; i < m; ++i) {
+            c[i + j * ldc] -= tile[i + j * mr];
+        }
+    }
+}
+
+static constexpr long SCALAR_MR = 4;
+static constexpr long SCALAR_NR = 4;
+
+static void scalarMicroKernel(long kc, const double* packed_a, const double* packed_b, double* c, long ldc, long m,
+                              long n) {
+    double tile[SCALAR_MR * SCALAR_NR] = {};
+    for (long p = 0; p < kc; ++p) {
+        for (long j = 0; j < SCALAR_NR; ++j) {
+            for (long i = 0; i < SCALAR_MR; ++i) {
+                tile[i + j * SCALAR_MR] += packed_a[p * SCALAR_MR + i] * packed_b[p * SCALAR_NR + j];
+            }
+        }
+    }
+    subtractTile(tile, SCALAR_MR, c, ldc, m, n);
+}
+
+static constexpr long AVX2_MR = 8;
+static constexpr long AVX2_NR = 4;
+
+__attribute__((target("avx2,fma"))) static void avx2MicroKernel(long kc, const double* packed_a,
+                                                                const double* packed_b, double* c, long ldc, long m,
+                                                                long n) {
+    __m256d acc[2][AVX2_NR];
+    for (long j = 0; j < AVX2_NR; ++j) {
+        acc[0][j] = _mm256_setzero_pd();
+        acc[1][j] = _mm256_setzero_pd();
+    }
+
+    for (long p = 0; p < kc; ++p) {
+        const __m256d a0 = _mm256_loadu_pd(packed_a + p * AVX2_MR);
+        const __m256d a1 = _mm256_loadu_pd(packed_a + p * AVX2_MR + 4);
+#pragma GCC unroll 4
+        for (long j = 0; j < AVX2_NR; ++j) {
+            const __m256d b = _mm256_broadcast_sd(packed_b + p * AVX2_NR + j);
+            acc[0][j] = _mm256_fmadd_pd(a0, b, acc[0][j]);
+            acc[1][j] = _mm256_fmadd_pd(a1, b, acc[1][j]);
+        }
+    }
+
+    if (m == AVX2_MR && n == AVX2_NR) {
+        for (long j = 0; j < AVX2_NR; ++j) {
+            double* column = c + j * ldc;
+            _mm256_storeu_pd(column, _mm256_sub_pd(_mm256_loadu_pd(column), acc[0][j]));
+            _mm256_storeu_pd(column + 4, _mm256_sub_pd(_mm256_loadu_pd(column + 4), acc[1][j]));
+        }
+        return;
+    }
+
+    alignas(64) double tile[AVX2_MR * AVX2_NR];
+    for (long j = 0; j < AVX2_NR; ++j) {
+        _mm256_store_pd(tile + j * AVX2_MR, acc[0][j]);
+        _mm256_store_pd(tile + j * AVX2_MR + 4, acc[1][j]);
+    }
+    subtractTile(tile, AVX2_MR, c, ldc, m, n);
+}
+
+static constexpr long AVX512_MR = 16;
+static constexpr long AVX512_NR = 8;
+
+__attribute__((target("avx512f"))) static void avx512MicroKernel(long kc, const double* packed_a,
+                                                                 const double* packed_b, double* c, long ldc, long m,
+                                                                 long n) {
+    __m512d acc[2][AVX512_NR];
+    for (long j = 0; j < AVX512_NR; ++j) {
+        acc[0][j] = _mm512_setzero_pd();
+        acc[1][j] = _mm512_setzero_pd();
+    }
+
+    for (long p = 0; p < kc; ++p) {
+        const __m512d a0 = _mm512_loadu_pd(packed_a + p * AVX512_MR);
+        const __m512d a1 = _mm512_loadu_pd(packed_a + p * AVX512_MR + 8);
+#pragma GCC unroll 8
+        for (long j = 0; j < AVX512_NR; ++j) {
+            const __m512d b = _mm512_set1_pd(packed_b[p * AVX512_NR + j]);
+            acc[0][j] = _mm512_fmadd_pd(a0, b, acc[0][j]);
+            acc[1][j] = _mm512_fmadd_pd(a1, b, acc[1][j]);
+        }
+    }
+
+    // edge rows are masked off, edge columns cut off. masked lanes are neither loaded nor stored.
+    const __mmask8 mask0 = m >= 8 ? 0xff : (1u << m) - 1;
+    const __mmask8 mask1 = m >= 16 ? 0xff : m <= 8 ? 0 : (1u << (m - 8)) - 1;
+    for (long j = 0; j < n; ++j) {
+        double* column = c + j * ldc;
+        _mm512_mask_storeu_pd(column, mask0, _mm512_sub_pd(_mm512_maskz_loadu_pd(mask0, column), acc[0][j]));
+        _mm512_mask_storeu_pd(column + 8, mask1, _mm512_sub_pd(_mm512_maskz_loadu_pd(mask1, column + 8), acc[1][j]));
+    }
+}
+
+// mc x kc part of a into panels of mr rows, step by step, zero padded to a multiple of mr rows.
+static void packA(const double* a, long lda, long mc, long kc, long mr, double* packed) {
+    for (long ir = 0; ir < mc; ir += mr) {
+        const long rows = std::min(mr, mc - ir);
+        for (long p = 0; p < kc; ++p) {
+            for (long i = 0; i < rows; ++i) {
+                *packed++ = a[ir + i + p * lda];
+            }
+            for (long i = rows; i < mr; ++i) {
+                *packed++ = 0.0;
+            }
+        }
+    }
+}
+
+// kc x nc part of b into panels of nr columns, step by step, zero padded to a multiple of nr columns.
+static void packB(const double* b, long ldb, long kc, long nc, long nr, double* packed) {
+    for (long jr = 0; jr < nc; jr += nr) {
+        const long columns = std::min(nr, nc - jr);
+        for (long p = 0; p < kc; ++p) {
+            for (long j = 0; j < columns; ++j) {
+                *packed++ = b[p + (jr + j) * ldb];
+            }
+            for (long j = columns; j < nr; ++j) {
+                *packed++ = 0.0;
+            }
+        }
+    }
+}
+
+// c -= a * b through packed panels, any m, n, k. BS != 0 fixes m = n = k = BS.
+template <long BS>
+static void gemmSubtractPacked(const MicroKernelShape& kernel, long m, long n, long k, const double* a, long lda,
+                               const double* b, long ldb, double* c, long ldc) {
+    if (BS != 0) {
+        m = n = k = BS;
+    }
+
+    // per thread, reused by every call.
+    thread_local std::vector<double> packed_a;
+    thread_local std::vector<double> packed_b;
+    packed_a.resize((GEMM_MC + kernel.mr) * GEMM_KC);
+    packed_b.resize((GEMM_NC + kernel.nr) * GEMM_KC);
+
+    for (long jc = 0; jc < n; jc += GEMM_NC) {
+        const long nc = std::min(GEMM_NC, n - jc);
+        for (long pc = 0; pc < k; pc += GEMM_KC) {
+            const long kc = std::min(GEMM_KC, k - pc);
+            packB(b + pc + jc * ldb, ldb, kc, nc, kernel.nr, packed_b.data());
+
+            for (long ic = 0; ic < m; ic += GEMM_MC) {
+                const long mc = std::min(GEMM_MC, m - ic);
+                packA(a + ic + pc * lda, lda, mc, kc, kernel.mr, packed_a.data());
+
+                for (long jr = 0; jr < nc; jr += kernel.nr) {
+                    for (long ir = 0; ir < mc; ir += kernel.mr) {
+                        kernel.run(kc, packed_a.data() + ir * kc, packed_b.data() + jr * kc,
+                                   c + ic + ir + (jc + jr) * ldc, ldc, std::min(kernel.mr, mc - ir),
+                                   std::min(kernel.nr, nc - jr));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// the instruction set specific pieces the block kernels below are built from:
+// - updateColumns<COUNT>: y[c][0:len] -= s[c] * x[0:len] for the columns c < COUNT.
+// - subtractDirectTile<K>: c[0:DIRECT_MR, 0:DIRECT_NR] -= a * b straight from the blocks, no packing.
+struct ScalarIsa {
+    static constexpr bool EXACT_DIVISION = true;
+    static constexpr long DIRECT_MR = 4;
+    static constexpr long DIRECT_NR = 4;
+
+    static MicroKernelShape getMicroKernel() { return {SCALAR_MR, SCALAR_NR, scalarMicroKernel}; }
+
+    template <long COUNT>
+    static void updateColumns(long len, const double* x, double* const* y, const double* s) {
+        for (long c = 0; c < COUNT; ++c) {
+            for (long i = 0; i < len; ++i) {
+                y[c][i] -= s[c] * x[i];
+            }
+        }
+    }
+
+    template <long K>
+    static void subtractDirectTile(const double* a, long lda, const double* b, long ldb, double* c, long ldc) {
+        double tile[DIRECT_MR * DIRECT_NR] = {};
+        for (long p = 0; p < K; ++p) {
+            for (long j = 0; j < DIRECT_NR; ++j) {
+                for (long i = 0; i < DIRECT_MR; ++i) {
+                    tile[i + j * DIRECT_MR] += a[i + p * lda] * b[p + j * ldb];
+                }
+            }
+        }
+        subtractTile(tile, DIRECT_MR, c, ldc, DIRECT_MR, DIRECT_NR);
+    }
+};
+
+struct Avx2Isa {
+    static constexpr bool EXACT_DIVISION = false;
+    static constexpr long DIRECT_MR = 8;
+    static constexpr long DIRECT_NR = 4;
+
+    static MicroKernelShape getMicroKernel() { return {AVX2_MR, AVX2_NR, avx2MicroKernel}; }
+
+    template <long COUNT>
+    __attribute__((target("avx2,fma"))) static void updateColumns(long len, const double* x, double* const* y,
+                                                                  const double* s) {
+        __m256d scale[COUNT];
+        for (long c = 0; c < COUNT; ++c) {
+            scale[c] = _mm256_set1_pd(s[c]);
+        }
+
+        long i = 0;
+        for (; i + 4 <= len; i += 4) {
+            const __m256d xv = _mm256_loadu_pd(x + i);
+            for (long c = 0; c < COUNT; ++c) {
+                _mm256_storeu_pd(y[c] + i, _mm256_fnmadd_pd(scale[c], xv, _mm256_loadu_pd(y[c] + i)));
+            }
+        }
+        if (i < len) {
+            const __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(len - i), _mm256_setr_epi64x(0, 1, 2, 3));
+            const __m256d xv = _mm256_maskload_pd(x + i, mask);
+            for (long c = 0; c < COUNT; ++c) {
+                _mm256_maskstore_pd(y[c] + i, mask,
+                                    _mm256_fnmadd_pd(scale[c], xv, _mm256_maskload_pd(y[c] + i, mask)));
+            }
+        }
+    }
+
+    template <long K>
+    __attribute__((target("avx2,fma"))) static void subtractDirectTile(const double* a, long lda, const double* b,
+                                                                       long ldb, double* c, long ldc) {
+        __m256d acc[2][DIRECT_NR];
+        for (long j = 0; j < DIRECT_NR; ++j) {
+            acc[0][j] = _mm256_setzero_pd();
+            acc[1][j] = _mm256_setzero_pd();
+        }
+        for (long p = 0; p < K; ++p) {
+            const __m256d a0 = _mm256_loadu_pd(a + p * lda);
+            const __m256d a1 = _mm256_loadu_pd(a + p * lda + 4);
+            for (long j = 0; j < DIRECT_NR; ++j) {
+                const __m256d bv = _mm256_broadcast_sd(b + p + j * ldb);
+                acc[0][j] = _mm256_fmadd_pd(a0, bv, acc[0][j]);
+                acc[1][j] = _mm256_fmadd_pd(a1, bv, acc[1][j]);
+            }
+        }
+        for (long j = 0; j < DIRECT_NR; ++j) {
+            double* column = c + j * ldc;
+            _mm256_storeu_pd(column, _mm256_sub_pd(_mm256_loadu_pd(column), acc[0][j]));
+            _mm256_storeu_pd(column + 4, _mm256_sub_pd(_mm256_loadu_pd(column + 4), acc[1][j]));
+        }
+    }
+};
+
+struct Avx512Isa {
+    static constexpr bool EXACT_DIVISION = false;
+    static constexpr long DIRECT_MR = 8;
+    static constexpr long DIRECT_NR = 8;
+
+    static MicroKernelShape getMicroKernel() { return {AVX512_MR, AVX512_NR, avx512MicroKernel}; }
+
+    template <long COUNT>
+    __attribute__((target("avx512f"))) static void updateColumns(long len, const double* x, double* const* y,
+                                                                 const double* s) {
+        __m512d scale[COUNT];
+        for (long c = 0; c < COUNT; ++c) {
+            scale[c] = _mm512_set1_pd(s[c]);
+        }
+
+        long i = 0;
+        for (; i + 8 <= len; i += 8) {
+            const __m512d xv = _mm512_loadu_pd(x + i);
+            for (long c = 0; c < COUNT; ++c) {
+                _mm512_storeu_pd(y[c] + i, _mm512_fnmadd_pd(scale[c], xv, _mm512_loadu_pd(y[c] + i)));
+            }
+        }
+        if (i < len) {
+            const __mmask8 mask = (1u << (len - i)) - 1;
+            const __m512d xv = _mm512_maskz_loadu_pd(mask, x + i);
+            for (long c = 0; c < COUNT; ++c) {
+                _mm512_mask_storeu_pd(y[c] + i, mask,
+                                      _mm512_fnmadd_pd(scale[c], xv, _mm512_maskz_loadu_pd(mask, y[c] + i)));
+            }
+        }
+    }
+
+    template <long K>
+    __attribute__((target("avx512f"))) static void subtractDirectTile(const double* a, long lda, const double* b,
+                                                                      long ldb, double* c, long ldc) {
+        __m512d acc[DIRECT_NR];
+        for (long j = 0; j < DIRECT_NR; ++j) {
+            acc[j] = _mm512_setzero_pd();
+        }
+        for (long p = 0; p < K; ++p) {
+            const __m512d av = _mm512_loadu_pd(a + p * lda);
+            for (long j = 0; j < DIRECT_NR; ++j) {
+                acc[j] = _mm512_fmadd_pd(av, _mm512_set1_pd(b[p + j * ldb]), acc[j]);
+            }
+        }
+        for (long j = 0; j < DIRECT_NR; ++j) {
+            double* column = c + j * ldc;
+            _mm512_storeu_pd(column, _mm512_sub_pd(_mm512_loadu_pd(column), acc[j]));
+        }
+    }
+};
+
+// columns updated per pass over the pivot column.
+static constexpr long COLUMN_GROUP = 4;
+
+// full blocks up to this size skip packing: they already sit in l1 and packing would cost as much as the update.
+static constexpr long DIRECT_BLOCK_LIMIT = 32;
+
+template <class Isa, long COUNT>
+static void updateColumnGroup(long len, const double* x, double* y, long stride, const double* s, long s_stride) {
+    double* group[COUNT];
+    double scales[COUNT];
+    for (long c = 0; c < COUNT; ++c) {
+        group[c] = y + c * stride;
+        scales[c] = s[c * s_stride];
+    }
+    Isa::template updateColumns<COUNT>(len, x, group, scales);
+}
+
+// y[:, j] -= s[j * s_stride] * x[0:len] for the columns j < columns of y, stride apart.
+template <class Isa>
+static void updateColumns(long len, const double* x, double* y, long stride, const double* s, long s_stride,
+                          long columns) {
+    if (len <= 0) {
+        return;
+    }
+    long j = 0;
+    for (; j + COLUMN_GROUP <= columns; j += COLUMN_GROUP) {
+        updateColumnGroup<Isa, COLUMN_GROUP>(len, x, y + j * stride, stride, s + j * s_stride, s_stride);
+    }
+    switch (columns - j) {
+        case 3:
+            return updateColumnGroup<Isa, 3>(len, x, y + j * stride, stride, s + j * s_stride, s_stride);
+        case 2:
+            return updateColumnGroup<Isa, 2>(len, x, y + j * stride, stride, s + j * s_stride, s_stride);
+        case 1:
+            return updateColumnGroup<Isa, 1>(len, x, y + j * stride, stride, s + j * s_stride, s_stride);
+    }
+}
+
+// row[j * stride] /= pivot for j < columns. only the scalar reference pays for the division on every element.
+template <class Isa>
+static void divideRow(double* row, long stride, long columns, double pivot) {
+    if (Isa::EXACT_DIVISION) {
+        for (long j = 0; j < columns; ++j) {
+            row[j * stride] /= pivot;
+        }
+        return;
+    }
+    const double reciprocal = 1.0 / pivot;
+    for (long j = 0; j < columns; ++j) {
+        row[j * stride] *= reciprocal;
+    }
+}
+
+// the block kernels. BS != 0 fixes every dimension to BS so that the loop bounds are constants, BS == 0 is the generic
+// version for any dimensions.
+
+template <class Isa, long BS>
+static void factorDiagonalBlock(double* a, long n, long stride) {
+    if (BS != 0) {
+        n = BS;
+    }
+    for (long k = 0; k < n; ++k) {
+        divideRow<Isa>(&a[k + (k + 1) * stride], stride, n - k - 1, a[k + k * stride]);
+        updateColumns<Isa>(n - k - 1, &a[k + 1 + k * stride], &a[k + 1 + (k + 1) * stride], stride,
+                           &a[k + (k + 1) * stride], stride, n - k - 1);
+    }
+}
+
+template <class Isa, long BS>
+static void solveColumnPanelBlock(double* a, const double* diag, long stride_a, long stride_diag, long dimi,
+                                  long dimk) {
+    if (BS != 0) {
+        dimi = dimk = BS;
+    }
+    for (long k = 0; k < dimk; ++k) {
+        updateColumns<Isa>(dimi, &a[k * stride_a], &a[(k + 1) * stride_a], stride_a,
+                           &diag[k + (k + 1) * stride_diag], stride_diag, dimk - k - 1);
+    }
+}
+
+template <class Isa, long BS>
+static void solveRowPanelBlock(const double* a, double* c, long dimi, long dimj, long stride_a, long stride_c) {
+    if (BS != 0) {
+        dimi = dimj = BS;
+    }
+    for (long k = 0; k < dimi; ++k) {
+        divideRow<Isa>(&c[k], stride_c, dimj, a[k + k * stride_a]);
+        updateColumns<Isa>(dimi - k - 1, &a[k + 1 + k * stride_a], &c[k + 1], stride_c, &c[k], stride_c, dimj);
+    }
+}
+
+template <class Isa, long BS>
+static void gemmSubtractBlock(long m, long n, long k, const double* a, long lda, const double* b, long ldb, double* c,
+                              long ldc) {
+    if constexpr (BS != 0 && BS <= DIRECT_BLOCK_LIMIT) {
+        static_assert(BS % Isa::DIRECT_MR == 0 && BS % Isa::DIRECT_NR == 0, "direct tiles must cover the block");
+        for (long j = 0; j < BS; j += Isa::DIRECT_NR) {
+            for (long i = 0; i < BS; i += Isa::DIRECT_MR) {
+                Isa::template subtractDirectTile<BS>(a + i, lda, b + j * ldb, ldb, c + i + j * ldc, ldc);
+            }
+        }
+    } else {
+        gemmSubtractPacked<BS>(Isa::getMicroKernel(), m, n, k, a, lda, b, ldb, c, ldc);
+    }
+}
+
+// the BS instantiation for full blocks, the generic one for the ragged edge blocks.
+
+template <class Isa, long BS>
+static void factorDiagonalKernel(double* a, long n, long stride) {
+    if (n == BS) {
+        factorDiagonalBlock<Isa, BS>(a, n, stride);
+    } else {
+        factorDiagonalBlock<Isa, 0>(a, n, stride);
+    }
+}
+
+template <class Isa, long BS>
+static void solveColumnPanelKernel(double* a, const double* diag, long stride_a, long stride_diag, long dimi,
+                                   long dimk) {
+    if (dimi == BS && dimk == BS) {
+        solveColumnPanelBlock<Isa, BS>(a, diag, stride_a, stride_diag, dimi, dimk);
+    } else {
+        solveColumnPanelBlock<Isa, 0>(a, diag, stride_a, stride_diag, dimi, dimk);
+    }
+}
+
+template <class Isa, long BS>
+static void solveRowPanelKernel(const double* a, double* c, long dimi, long dimj, long stride_a, long stride_c) {
+    if (dimi == BS && dimj == BS) {
+        solveRowPanelBlock<Isa, BS>(a, c, dimi, dimj, stride_a, stride_c);
+    } else {
+        solveRowPanelBlock<Isa, 0>(a, c, dimi, dimj, stride_a, stride_c);
+    }
+}
+
+template <class Isa, long BS>
+static void gemmSubtractKernel(long m, long n, long k, const double* a, long lda, const double* b, long ldb, double* c,
+                               long ldc) {
+    if (m == BS && n == BS && k == BS) {
+        gemmSubtractBlock<Isa, BS>(m, n, k, a, lda, b, ldb, c, ldc);
+    } else {
+        gemmSubtractBlock<Isa, 0>(m, n, k, a, lda, b, ldb, c, ldc);
+    }
+}
+
+template <class Isa, long BS>
+static BlockKernels getBlockKernels() {
+    return {factorDiagonalKernel<Isa, BS>, solveColumnPanelKernel<Isa, BS>, solveRowPanelKernel<Isa, BS>,
+            gemmSubtractKernel<Isa, BS>};
+}
+
+template <class Isa>
+static BlockKernels getBlockKernels(long block_size) {
+    switch (block_size) {
+        case 8:
+            return getBlockKernels<Isa, 8>();
+        case 16:
+            return getBlockKernels<Isa, 16>();
+        case 32:
+            return getBlockKernels<Isa, 32>();
+        case 64:
+            return getBlockKernels<Isa, 64>();
+        case 128:
+            return getBlockKernels<Isa, 128>();
+    }
+    return getBlockKernels<Isa, 0>();
+}
+
+bool isBlockSizeSpecialized(long block_size) {
+    switch (block_size) {
+        case 8:
+        case 16:
+        case 32:
+        case 64:
+        case 128:
+            return true;
+    }
+    return false;
+}
+
+BlockKernels getBlockKernels(KernelBackend backend, long block_size) {
+    switch (backend) {
+        case KernelBackend::Avx512:
+            return getBlockKernels<Avx512Isa>(block_size);
+        case KernelBackend::Avx2:
+            return getBlockKernels<Avx2Isa>(block_size);
+        case KernelBackend::Scalar:
+            break;
+    }
+    return getBlockKernels<ScalarIsa>(block_size);
+}
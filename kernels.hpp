@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+// which instruction set the numerical kernels run on. Scalar is the portable reference.
+enum class KernelBackend { Scalar, Avx2, Avx512 };
+
+// the widest backend this cpu supports, checked with __builtin_cpu_supports.
+KernelBackend detectKernelBackend();
+bool isKernelBackendSupported(KernelBackend backend);
+const char* getKernelBackendName(KernelBackend backend);
+
+// "scalar", "avx2" or "avx512".
+bool parseKernelBackend(const std::string& name, KernelBackend& backend);
+
+// the block kernels of lu on column major blocks, picked once per run for a backend and block size.
+// - factor_diagonal (lu0): factors the n x n diagonal block a in place into l (with diagonal) and unit upper u.
+// - solve_column_panel (bdiv): a = a * u^-1 for a dimi x dimk column panel block, u from the factored diagonal block.
+// - solve_row_panel (bmodd): c = l^-1 * c for a dimi x dimj row panel block, l from the factored diagonal block a.
+// - gemm_subtract (bmod): c -= a * b, a is m x k, b is k x n. a and b are packed into micro panels and c is updated
+//   in register tiles by the backend's micro kernel.
+// the panel kernels are right looking rank-1 updates. the vector backends multiply by the reciprocal of the pivot and
+// update four columns per pass over the pivot column, masking the short tails. Scalar keeps the division.
+struct BlockKernels {
+    void (*factor_diagonal)(double* a, long n, long stride);
+    void (*solve_column_panel)(double* a, const double* diag, long stride_a, long stride_diag, long dimi, long dimk);
+    void (*solve_row_panel)(const double* a, double* c, long dimi, long dimj, long stride_a, long stride_c);
+    void (*gemm_subtract)(long m, long n, long k, const double* a, long lda, const double* b, long ldb, double* c,
+                          long ldc);
+};
+
+// block sizes 8, 16, 32, 64 and 128 get kernels compiled for exactly that size (full blocks up to 32 also skip the
+// packing in gemm_subtract), which fall back to the generic kernels for the ragged edge blocks. any other block size
+// gets the generic kernels.
+bool isBlockSizeSpecialized(long block_size);
+BlockKernels getBlockKernels(KernelBackend backend, long block_size);
@@ -0,0 +1,181 @@
+#include "latency.hpp"
+
+#include <x86intrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <tuple>
+
+#include "cha.hpp"
+
+static constexpr auto CACHE_LINE_SIZE = 64;
+
+struct alignas(CACHE_LINE_SIZE) PingPongLine {
+    std::atomic<long> turn{0};
+};
+
+// returns the one way latency of a single line bouncing between the two cores.
+static double pingPong(int core_a, int core_b, int round_trips) {
+    PingPongLine line;
+    std::atomic<bool> ready{false};
+
+    std::thread pong([&] {
+        stick_this_thread_to_core(core_b);
+        ready = true;
+        for (long i = 0; i < round_trips; ++i) {
+            while (line.turn.load(std::memory_order_acquire) != 2 * i + 1) {
+                _mm_pause();
+            }
+            line.turn.store(2 * i + 2, std::memory_order_release);
+        }
+    });
+
+    stick_this_thread_to_core(core_a);
+    while (!ready) {
+        _mm_pause();
+    }
+
+    const auto begin = __rdtsc();
+    for (long i = 0; i < round_trips; ++i) {
+        line.turn.store(2 * i + 1, std::memory_order_release);
+        while (line.turn.load(std::memory_order_acquire) != 2 * i + 2) {
+            _mm_pause();
+        }
+    }
+    const auto end = __rdtsc();
+
+    pong.join();
+    return static_cast<double>(end - begin) / (2.0 * round_trips);
+}
+
+std::vector<std::vector<double>> measureCoreToCoreLatency(const std::vector<int> &cores, int round_trips,
+                                                          int repetitions) {
+    assert(repetitions > 0);
+    std::vector<std::vector<double>> latencies(cores.size(), std::vector<double>(cores.size(), 0.0));
+
+    for (int i = 0; i < cores.size(); ++i) {
+        for (int j = i + 1; j < cores.size(); ++j) {
+            std::vector<double> samples;
+            for (int r = 0; r < repetitions; ++r) {
+                samples.push_back(pingPong(cores[i], cores[j], round_trips));
+            }
+
+            // median is robust against the odd interrupt or frequency transition.
+            std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+            latencies[i][j] = latencies[j][i] = samples[samples.size() / 2];
+        }
+        std::cout << "measured core " << cores[i] << std::endl;
+    }
+
+    return latencies;
+}
+
+double measureFlushReloadLatency(int core, const void *line, int iterations) {
+    assert(iterations > 0);
+    stick_this_thread_to_core(core);
+
+    const volatile char *ptr = static_cast<const volatile char *>(line);
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    unsigned int aux;
+
+    for (int i = 0; i < iterations; ++i) {
+        _mm_clflush(const_cast<const char *>(ptr));
+        _mm_mfence();
+        const auto begin = __rdtscp(&aux);
+        (void)*ptr;
+        const auto end = __rdtscp(&aux);
+        _mm_lfence();
+        samples.push_back(static_cast<double>(end - begin));
+    }
+
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+// solves the 3x3 system in place with gaussian elimination. returns false if it is singular.
+static bool solve3(double m[3][3], double v[3], double x[3]) {
+    for (int col = 0; col < 3; ++col) {
+        int pivot = col;
+        for (int row = col + 1; row < 3; ++row) {
+            if (std::fabs(m[row][col]) > std::fabs(m[pivot][col])) {
+                pivot = row;
+            }
+        }
+        if (std::fabs(m[pivot][col]) < 1e-9) {
+            return false;
+        }
+        std::swap(m[col], m[pivot]);
+        std::swap(v[col], v[pivot]);
+
+        for (int row = col + 1; row < 3; ++row) {
+            const double factor = m[row][col] / m[col][col];
+            for (int k = col; k < 3; ++k) {
+                m[row][k] -= factor * m[col][k];
+            }
+            v[row] -= factor * v[col];
+        }
+    }
+
+    for (int row = 2; row >= 0; --row) {
+        x[row] = v[row];
+        for (int k = row + 1; k < 3; ++k) {
+            x[row] -= m[row][k] * x[k];
+        }
+        x[row] /= m[row][row];
+    }
+    return true;
+}
+
+HopCostFit fitHopCosts(Topology &topo, const std::vector<int> &cores,
+                       const std::vector<std::vector<double>> &latencies) {
+    HopCostFit fit;
+
+    // normal equations of latency = base + vertical * dx + horizontal * dy.
+    double ata[3][3] = {};
+    double atb[3] = {};
+    std::vector<std::tuple<double, double, double>> samples;  // dx, dy, latency
+
+    for (int i = 0; i < cores.size(); ++i) {
+        const auto tile_i = topo.getTileByCore(cores[i]);
+        for (int j = i + 1; j < cores.size(); ++j) {
+            const auto tile_j = topo.getTileByCore(cores[j]);
+            if (tile_i.x == UNDEFINED || tile_j.x == UNDEFINED) {
+                continue;  // core is not on this mesh, e.g. other socket or not a mesh part at all.
+            }
+
+            const double row[3] = {1.0, static_cast<double>(std::abs(tile_i.x - tile_j.x)),
+                                   static_cast<double>(std::abs(tile_i.y - tile_j.y))};
+            for (int r = 0; r < 3; ++r) {
+                for (int c = 0; c < 3; ++c) {
+                    ata[r][c] += row[r] * row[c];
+                }
+                atb[r] += row[r] * latencies[i][j];
+            }
+            samples.emplace_back(row[1], row[2], latencies[i][j]);
+        }
+    }
+
+    double x[3];
+    if (samples.size() < 3 || !solve3(ata, atb, x)) {
+        return fit;
+    }
+
+    fit.base_latency = x[0];
+    fit.vertical_hop_cost = x[1];
+    fit.horizontal_hop_cost = x[2];
+    fit.sample_count = samples.size();
+
+    double squared_error = 0.0;
+    for (const auto &[dx, dy, latency] : samples) {
+        const double residual = latency - (x[0] + x[1] * dx + x[2] * dy);
+        squared_error += residual * residual;
+    }
+    fit.rms_error = std::sqrt(squared_error / samples.size());
+
+    return fit;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include "topology.hpp"
+
+// one way cache line transfer latency in tsc cycles between every pair of the given cores, measured by ping-ponging a
+// line between two threads pinned with stick_this_thread_to_core. latencies[i][j] refers to cores[i] and cores[j],
+// the diagonal is 0.
+std::vector<std::vector<double>> measureCoreToCoreLatency(const std::vector<int>& cores, int round_trips,
+                                                          int repetitions);
+
+// median latency in tsc cycles of loading the line from the given core right after flushing it, i.e. a trip through
+// the home cha of the line. pins the calling thread.
+double measureFlushReloadLatency(int core, const void* line, int iterations);
+
+struct HopCostFit {
+    double base_latency = 0.0;
+    double vertical_hop_cost = 0.0;
+    double horizontal_hop_cost = 0.0;
+    double rms_error = 0.0;
+    int sample_count = 0;  // core pairs that were placed on the mesh, 0 means no fit was possible.
+};
+
+// least squares fit of latency = base + vertical * |dx| + horizontal * |dy| over all pairs whose tiles are known.
+HopCostFit fitHopCosts(Topology& topo, const std::vector<int>& cores,
+                       const std::vector<std::vector<double>>& latencies);
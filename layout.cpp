@@ -0,0 +1,81 @@
+#include "layout.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+static constexpr long DOUBLES_PER_CACHE_LINE = 8;
+
+bool parseLayout(const std::string& name, Layout& layout) {
+    if (name == "column") {
+        layout = Layout::Column;
+    } else if (name == "blocked") {
+        layout = Layout::Blocked;
+    } else if (name == "morton") {
+        layout = Layout::Morton;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+long getBlockPitch(long block_size) {
+    return (block_size * block_size + DOUBLES_PER_CACHE_LINE - 1) / DOUBLES_PER_CACHE_LINE * DOUBLES_PER_CACHE_LINE;
+}
+
+long getStorageSize(Layout layout, long n, long block_size) {
+    if (layout == Layout::Column) {
+        return n * n;
+    }
+    const long nblocks = (n + block_size - 1) / block_size;
+    return nblocks * nblocks * getBlockPitch(block_size);
+}
+
+// interleaves the bits of I (even positions) and J (odd positions).
+static std::uint64_t getMortonCode(std::uint32_t I, std::uint32_t J) {
+    std::uint64_t code = 0;
+    for (int bit = 0; bit < 32; ++bit) {
+        code |= static_cast<std::uint64_t>((I >> bit) & 1) << (2 * bit);
+        code |= static_cast<std::uint64_t>((J >> bit) & 1) << (2 * bit + 1);
+    }
+    return code;
+}
+
+std::vector<long> getBlockOffsets(Layout layout, long n, long block_size) {
+    const long nblocks = (n + block_size - 1) / block_size;
+    const long pitch = getBlockPitch(block_size);
+    std::vector<long> offsets(nblocks * nblocks);
+
+    switch (layout) {
+        case Layout::Column:
+            for (long J = 0; J < nblocks; ++J) {
+                for (long I = 0; I < nblocks; ++I) {
+                    offsets[I + J * nblocks] = I * block_size + J * block_size * n;
+                }
+            }
+            break;
+        case Layout::Blocked:
+            for (long J = 0; J < nblocks; ++J) {
+                for (long I = 0; I < nblocks; ++I) {
+                    offsets[I + J * nblocks] = (J + I * nblocks) * pitch;
+                }
+            }
+            break;
+        case Layout::Morton: {
+            // nblocks is rarely a power of two, so blocks are ranked by their code instead of placed at it. that
+            // keeps the storage at nblocks^2 blocks.
+            std::vector<std::pair<std::uint64_t, long>> codes;  // (code, I + J * nblocks)
+            for (long J = 0; J < nblocks; ++J) {
+                for (long I = 0; I < nblocks; ++I) {
+                    codes.emplace_back(getMortonCode(I, J), I + J * nblocks);
+                }
+            }
+            std::sort(codes.begin(), codes.end());
+            for (long rank = 0; rank < codes.size(); ++rank) {
+                offsets[codes[rank].second] = rank * pitch;
+            }
+            break;
+        }
+    }
+    return offsets;
+}
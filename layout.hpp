@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// how the blocks of the matrix sit in its storage. Column is the classic column major array with stride n, the others
+// store every block contiguously (stride block_size) and cache line aligned: Blocked one block row after the other,
+// Morton in z-order of (I, J) so that neighbouring blocks stay close at every scale.
+enum class Layout { Column, Blocked, Morton };
+
+// "column", "blocked" or "morton".
+bool parseLayout(const std::string& name, Layout& layout);
+
+// doubles between the starts of two contiguous blocks, a whole number of cache lines.
+long getBlockPitch(long block_size);
+
+// doubles the storage of a n x n matrix needs.
+long getStorageSize(Layout layout, long n, long block_size);
+
+// offset in doubles of the first element of every block (I, J), indexed by I + J * nblocks.
+std::vector<long> getBlockOffsets(Layout layout, long n, long block_size);
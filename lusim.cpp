@@ -0,0 +1,123 @@
+/*************************************************************************/
+/*                                                                       */
+/*  Offline coherence/mesh latency simulator for LU thread mappings      */
+/*                                                                       */
+/*  Replays an address trace recorded with LU -T through a directory-at- */
+/*  CHA MESI model and reports per thread stall estimates for one or     */
+/*  more thread -> core mappings. Runs on any Linux box.                 */
+/*                                                                       */
+/*  Command line options:                                                */
+/*                                                                       */
+/*  -fF : Trace file F recorded by LU -T.                                */
+/*  -mM : Comma separated thread -> core mapping M. May be repeated.     */
+/*        Default is the base mapping of LU (even cores).                */
+/*  -s  : Use a synthetic CHA hash even if the trace carries homes.      */
+/*  -MF : Mesh config F (written by calibrate). Default: koc cascade.    */
+/*  -v  : Print per thread statistics.                                   */
+/*  -h  : Print out command line options.                                */
+/*                                                                       */
+/*************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "simulator.hpp"
+#include "topology.hpp"
+#include "trace.hpp"
+
+std::vector<int> parseMapping(const std::string& text)
+{
+  std::vector<int> mapping;
+  std::istringstream iss(text);
+  std::string core;
+  while (std::getline(iss, core, ',')) {
+    mapping.push_back(atoi(core.c_str()));
+  }
+  return mapping;
+}
+
+int main(int argc, char *argv[])
+{
+  long ch;
+  extern char *optarg;
+  std::string trace_file;
+  std::vector<std::string> mappings;
+  SimulatorConfig config;
+  MeshConfig mesh_config;
+  long verbose = 0;
+
+  while ((ch = getopt(argc, argv, "f:m:M:svh")) != -1) {
+    switch(ch) {
+    case 'f': trace_file = optarg; break;
+    case 'm': mappings.push_back(optarg); break;
+    case 's': config.synthetic_homes = true; break;
+    case 'M': if (!loadMeshConfig(optarg, mesh_config)) {
+                exit(-1);
+              }
+              break;
+    case 'v': verbose = 1; break;
+    case 'h': printf("Usage: lusim <options>\n\n");
+              printf("options:\n");
+              printf("  -fF : Trace file F recorded by LU -T.\n");
+              printf("  -mM : Comma separated thread -> core mapping M. May be repeated.\n");
+              printf("        Default is the base mapping of LU (even cores).\n");
+              printf("  -s  : Use a synthetic CHA hash even if the trace carries homes.\n");
+              printf("  -MF : Mesh config F (written by calibrate). Default: koc cascade.\n");
+              printf("  -v  : Print per thread statistics.\n");
+              printf("  -h  : Print out command line options.\n\n");
+              exit(0);
+              break;
+    }
+  }
+
+  if (trace_file.empty()) {
+    fprintf(stderr, "ERROR: no trace file given, see -h.\n");
+    exit(-1);
+  }
+
+  Trace trace;
+  if (!readTrace(trace_file, trace)) {
+    exit(-1);
+  }
+
+  printf("\n");
+  printf("LU Trace Simulation\n");
+  printf("     %ld by %ld Matrix\n", (long) trace.header.n, (long) trace.header.n);
+  printf("     %ld Threads\n", (long) trace.header.thread_count);
+  printf("     %ld by %ld Element Blocks\n", (long) trace.header.block_size, (long) trace.header.block_size);
+  printf("     %zu Records, %s homes\n", trace.records.size(),
+         (trace.homes.empty() || config.synthetic_homes) ? "synthetic" : "hashed");
+  printf("\n");
+
+  if (mappings.empty()) {
+    std::string base;
+    for (long i = 0; i < trace.header.thread_count; i++) {
+      base += (i ? "," : "") + std::to_string(2*i);
+    }
+    mappings.push_back(base);
+  }
+
+  auto topo = Topology(mesh_config);
+  if (topo.getBaseLatency() > 0) {
+    config.cha_lookup_cycles = topo.getBaseLatency(); /* calibrated */
+  }
+  for (const auto& mapping : mappings) {
+    const auto thread_to_core = parseMapping(mapping);
+    if (thread_to_core.size() != trace.header.thread_count) {
+      fprintf(stderr, "ERROR: mapping %s has %zu cores, trace has %ld threads.\n",
+              mapping.c_str(), thread_to_core.size(), (long) trace.header.thread_count);
+      continue;
+    }
+
+    CoherenceSimulator simulator(topo, thread_to_core, config);
+    simulator.run(trace);
+    simulator.printStats(mapping.c_str(), verbose);
+  }
+
+  exit(0);
+}
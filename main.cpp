@@ -27,7 +27,59 @@
 /*  -pP : P = number of processors.                                      */
 /*  -bB : Use a block size of B. BxB elements should fit in cache for    */
 /*        good performance. Small block sizes (B=8, B=16) work well.     */
+/*  -c  : Copy non-locally allocated blocks to local memory before use.  */
 /*  -s  : Print individual processor timing statistics.                  */
+/*  -l  : Refine thread mapping to minimize maximum mesh link load.      */
+/*  -TF : Record the address stream of the tracking pass to file F,      */
+/*        to be replayed offline by lusim.                               */
+/*  -MF : Load mesh config F (written by calibrate) instead of the       */
+/*        built-in koc cascade topology.                                 */
+/*  -OS : Give blocks to threads by strategy S = cyclic (round robin,    */
+/*        the default), 2d (block-cyclic over a processor grid), column  */
+/*        or row (whole block columns or rows round robin), table:F      */
+/*        (a pattern of thread ids per block row in file F), profile     */
+/*        (balanced by the task times of an untimed first run), graph    */
+/*        (a partition of the block dependency graph with few reads      */
+/*        across threads) or cha (see -a). Applies to every run but the  */
+/*        cha aware one with -Ocha.                                      */
+/*  -a  : CHA-aware block ownership: keep threads on the base cores and  */
+/*        give each block to the thread closest to its CHAs instead.     */
+/*        Same as -Ocha.                                                 */
+/*  -S  : Slice-colored blocks: store every block in memory whose lines  */
+/*        are homed on CHAs close to the core of its owner.              */
+/*  -RK : Copy the panels of every K step into K replicas spread over    */
+/*        the mesh and let bmod read the closest one.                    */
+/*  -HM : Back a and rhs with M = 4k, thp, 2m or 1g pages, pre-faulted.  */
+/*        Falls back to the next smaller page size if M is unavailable.  */
+/*  -m  : mlock a and rhs.                                               */
+/*  -NP : Every thread first touches the blocks it owns, under numa      */
+/*        policy P = local, interleave or owner (bound to its node).     */
+/*  -gC : Generate a in parallel with a counter-based generator, matrix  */
+/*        class C = random, dominant, banded, blocksparse or spd.        */
+/*  -k  : Keep a pristine copy of a and restore it in parallel between   */
+/*        runs instead of regenerating it.                               */
+/*  -LL : Store a in layout L = column (column major, the default),      */
+/*        blocked (every block contiguous, one block row after another)  */
+/*        or morton (contiguous blocks in Z-order).                      */
+/*  -KK : Run the block kernels on backend K = scalar (the reference),   */
+/*        avx2 or avx512. Defaults to the widest the cpu supports.       */
+/*  -xS : Schedule the block operations with S = barrier (a barrier      */
+/*        after the diagonal block and the perimeter of every step, the  */
+/*        default), dataflow (every block operation runs on its owner    */
+/*        as soon as the blocks it reads are final), steal (dataflow,    */
+/*        idle threads steal updates, mesh-near threads first) or        */
+/*        lookahead (the owners factor the next panels while the         */
+/*        trailing updates before them finish).                          */
+/*  -DD : With -xlookahead, let up to D = 1 (default), 2 or 3 trailing   */
+/*        updates run behind the panel being factored, the blocks of     */
+/*        the next D panels are updated first.                           */
+/*  -WB : Synchronize the team with barrier B = condvar (mutex and       */
+/*        condition variable, the default) or tree (spinning combining   */
+/*        tree shaped by the mesh, futex once the spin runs out).        */
+/*  -rR : Run each timed BM R times back to back on the same threads     */
+/*        and report the average.                                        */
+/*  -e  : Elastic team: with -xbarrier, park threads as the trailing     */
+/*        matrix shrinks and finish on one thread once it fits in L2.    */
 /*  -t  : Test output.                                                   */
 /*  -o  : Print out matrix values.                                       */
 /*  -h  : Print out command line options.                                */
@@ -67,6 +119,7 @@ Written shared data is A matrix. I will mark the lines that this specific matrix
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 
@@ -90,8 +143,23 @@ const int CACHELINE_SIZE = 64;
 #include <vector>
 #include <chrono>
 
+#include "barrier.hpp"
 #include "cha.hpp"
+#include "congestion.hpp"
+#include "elastic.hpp"
+#include "hugepage.hpp"
+#include "kernels.hpp"
+#include "layout.hpp"
+#include "matgen.hpp"
+#include "numa.hpp"
+#include "ownership.hpp"
+#include "perf_events.hpp"
+#include "replica.hpp"
+#include "scheduler.hpp"
+#include "slice_allocator.hpp"
 #include "topology.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
 // AYDIN
 std::mutex map_mutex;
 std::map<long, std::multiset<double *>> // TODO: set the address type accordingly.
@@ -162,30 +230,6 @@ int getMostAccessedCHA(int tid1,
     return tile.cha;
 }
 
-void stick_this_thread_to_core(int core_id) {
-    int num_cores = sysconf(_SC_NPROCESSORS_ONLN);
-    if (core_id < 0 || core_id >= num_cores) {
-        std::cerr << "error binding thread to core: " << core_id << '\n';
-        // SPDLOG_ERROR("error binding thread to core {}!", core_id);
-        return;
-    }
-
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(core_id, &cpuset);
-
-    pthread_t current_thread = pthread_self();
-
-    int res = pthread_setaffinity_np(current_thread, sizeof(cpu_set_t), &cpuset);
-
-    if (res == 0) {
-        // std::cout << "thread bound to core " << core_id << std::endl;
-        //        SPDLOG_INFO("Thread bound to core {} successfully.", core_id);
-    } else {
-        //        SPDLOG_ERROR("Error in binding this thread to core {}.", core_id);
-    }
-}
-
 void assertRoot() {
     uid_t uid = getuid();
     if (uid == 0) {
@@ -219,9 +263,7 @@ struct GlobalMemory {
   unsigned long rf;
   unsigned long rs;
   unsigned long done;
-  long id;
   struct { pthread_mutex_t bar_mutex; pthread_cond_t bar_cond; unsigned bar_teller; } start;
-  pthread_mutex_t idlock;
 } *Global;
 
 struct LocalCopies {
@@ -229,6 +271,8 @@ struct LocalCopies {
   double t_in_solve;
   double t_in_mod;
   double t_in_bar;
+  double *arena;       /* -c: slot I holds block (I, K), slot nblocks+J block (K, J) */
+  long *arena_step;    /* K the copy in each slot was taken in, -1 if none */
 };
 
 long n = DEFAULT_N;          /* The size of the matrix */
@@ -238,23 +282,94 @@ long nblocks;                /* Number of blocks in each dimension */
 long num_rows;               /* Number of processors per row of processor grid */
 long num_cols;               /* Number of processors per col of processor grid */
 double *a;                   /* a = lu; l and u both placed back in a */
+long a_size;                 /* Doubles allocated for a, depends on the layout */
+Layout layout = Layout::Column; /* How the blocks are arranged in a */
+double **blocks;             /* blocks[I + J*nblocks] = first element of block (I, J) */
+long block_stride;           /* Distance between two columns of a block */
 double *rhs;
 long *proc_bytes;            /* Bytes to malloc per processor to hold blocks of A*/
 long test_result = 0;        /* Test result of factorization? */
 long doprint = 0;            /* Print out matrix values? */
 long dostats = 0;            /* Print out individual processor statistics? */
-
-void* SlaveStart(void*);
-void OneSolve(long n, long block_size, long MyNum, long dostats);
+long copy_local = 0;         /* Copy remote panel blocks to a local arena before bmod? */
+long minimize_link_load = 0; /* Map threads by max mesh link load instead of hops? */
+const char *trace_file = NULL; /* Where to record the tracking pass address stream */
+TraceWriter *trace = NULL;   /* Non-NULL only while the tracking pass is recorded */
+long tracking = 0;           /* Inside the tracking pass? Only it records addresses and runs the reference bmod */
+KernelBackend kernel_backend = detectKernelBackend(); /* Instruction set of the block kernels */
+BlockKernels block_kernels;  /* lu0/bdiv/bmodd/bmod for kernel_backend and block_size */
+Schedule schedule = Schedule::Barrier; /* How lu orders the block operations */
+DataflowScheduler *dataflow = NULL; /* Task graph of the current run with -xdataflow or -xsteal */
+BarrierKind barrier_kind = BarrierKind::Condvar; /* How the threads of a team meet */
+TreeBarrier *tree_barrier = NULL; /* The current team's barrier with -Wtree */
+long elastic_team = 0;       /* Shrink the team with the trailing matrix? */
+ElasticTeam *elastic = NULL; /* The current team's steps with -e */
+long lookahead_depth = 1;    /* Trailing updates a panel may run ahead of with -xlookahead */
+LookaheadProgress *lookahead = NULL; /* Progress of the current run with -xlookahead */
+MeshConfig mesh_config;      /* CHA/core placement and hop costs of this host */
+OwnershipStrategy ownership = OwnershipStrategy::Cyclic; /* How blocks are given to threads */
+std::string owner_table_file; /* Pattern of -Otable: */
+std::vector<long> block_owners; /* Owner of block I + J*nblocks, empty for round robin */
+std::vector<long> static_owners; /* block_owners of every run but the cha aware one with -Ocha */
+TaskProfile *profile = NULL; /* Block task times, only during the -Oprofile run */
+long slice_colored = 0;      /* Place block storage near the owner's core? */
+long replica_count = 0;      /* Panel replicas read by bmod in the cha aware run */
+double **replica_blocks = NULL; /* [r*2*nblocks + I] = block (I, K), [r*2*nblocks + nblocks + J] = block (K, J) */
+long *thread_replica;        /* Replica each thread reads from */
+PageMode page_mode = PageMode::Default; /* Page size backing a and rhs */
+long lock_pages = 0;         /* mlock a and rhs? */
+PageAllocation a_pages;      /* Backing of a and rhs unless posix_memalign'd */
+PageAllocation rhs_pages;
+NumaPolicy numa_policy = NumaPolicy::None; /* How the threads first touch a, None leaves it to InitA */
+long generate_a = 0;         /* Generate a in parallel instead of InitA? */
+MatrixClass matrix_class = MatrixClass::Random;
+MatrixGenerator *generator = NULL; /* Counter-based generator, NULL for the lrand48 stream of InitA */
+long keep_pristine = 0;      /* Restore a from a snapshot between runs? */
+double *pristine = NULL;     /* Snapshot of a, block I + J*nblocks at (I + J*nblocks)*bs*bs */
+ThreadPool *pool = NULL;      /* The P threads every team runs on, created once */
+int *team_cores;             /* Cores of the team RunTeam runs, thread MyNum on team_cores[MyNum] */
+struct LocalCopies **local_copies; /* [MyNum]: kept by the thread across runs */
+long reps = 1;               /* Timed runs of each BM */
+TlbMissCounter **tlb_counters; /* [MyNum]: dTLB misses of that pool thread, opened by it */
+long long *tlb_miss_counts;  /* [MyNum]: its misses in CountedSlaveStart since the last SumTlbMisses */
+
+void SlaveStart(long MyNum);
+void CountedSlaveStart(long MyNum);
+long long SumTlbMisses(void);
+void RunTeam(void (*work)(long MyNum), int *cores);
+void PlaceA(int *cores);
+void FirstTouchA(long MyNum);
+void GenerateA(long MyNum);
+void SnapshotA(long MyNum);
+void RestoreA(long MyNum);
+void ResetA(int *cores);
+void ProfileOwnership(int *cores);
+double Seconds(void);
+void OneSolve(long n, long block_size, long MyNum, long dostats, int *cores);
+void PrepareTeam(int *cores, long shrink);
+void Barrier(long MyNum);
+void StepBarrier(long MyNum, long K);
+long StepOwner(long I, long J, long K);
 void lu0(double *a, long n, long stride, long MyNum);
 void bdiv(double *a, double *diag, long stride_a, long stride_diag, long dimi, long dimk, long MyNum);
 void bmodd(double *a, double *c, long dimi, long dimj, long stride_a, long stride_c, long MyNum);
-void bmod(double *a, double *b, double *c, long dimi, long dimj, long dimk, long stride, long MyNum);
+void bmod(double *a, double *b, double *c, long dimi, long dimj, long dimk, long stride_a, long stride_b, long stride_c, long MyNum);
 void daxpy(double *a, double *b, long n, double alpha, long MyNum);
 long BlockOwner(long I, long J);
-long BlockOwnerColumn(long I, long J);
-long BlockOwnerRow(long I, long J);
 void lu(long n, long bs, long MyNum, struct LocalCopies *lc, long dostats);
+void DataflowLu(long n, long bs, long MyNum, struct LocalCopies *lc, long dostats);
+void LookaheadLu(long n, long bs, long MyNum, struct LocalCopies *lc, long dostats);
+void LookaheadUpdate(long b, struct LocalCopies *lc, long MyNum, long dostats);
+void LookaheadPanel(long b, struct LocalCopies *lc, long MyNum, long dostats);
+void UpdateBlock(long I, long J, long K, struct LocalCopies *lc, long MyNum);
+std::vector<long> BlockOwnerTable(void);
+double *LocalPanel(struct LocalCopies *lc, long slot, long K, long owner, double *src, long *stride, long dimi, long dimj, long MyNum);
+void LayoutBlocks(void);
+void ToColumnMajor(double *dst);
+void SliceColoredBlocks(SliceAllocator *allocator, int *cores);
+void AllocateReplicas(SliceAllocator *allocator, const ReplicaPlan &plan);
+void CopyToReplicas(double *src, long stride, long dimi, long dimj, long slot);
+double *Elem(long i, long j);
 void InitA(double *rhs);
 double TouchA(long bs, long MyNum);
 void PrintA(void);
@@ -287,14 +402,85 @@ int main(int argc, char *argv[])
 
   {long time{}; (start) = ::time(0);};
 
-  while ((ch = getopt(argc, argv, "n:p:b:cstoh")) != -1) {
+  while ((ch = getopt(argc, argv, "n:p:b:T:M:R:H:N:g:L:K:x:D:W:r:O:cstolahSmke")) != -1) {
     switch(ch) {
     case 'n': n = atoi(optarg); break;
     case 'p': P = atoi(optarg); break;
     case 'b': block_size = atoi(optarg); break;
     case 's': dostats = 1; break;
+    case 'c': copy_local = 1; break;
     case 't': test_result = !test_result; break;
     case 'o': doprint = !doprint; break;
+    case 'l': minimize_link_load = 1; break;
+    case 'a': ownership = OwnershipStrategy::Cha; break;
+    case 'O': if (!parseOwnershipStrategy(optarg, ownership, owner_table_file)) {
+                printerr("Ownership must be cyclic, 2d, column, row, table:<file>, profile, graph or cha.\n");
+                exit(-1);
+              }
+              break;
+    case 'S': slice_colored = 1; break;
+    case 'R': replica_count = atoi(optarg); break;
+    case 'H': if (!parsePageMode(optarg, page_mode)) {
+                printerr("Page size must be 4k, thp, 2m or 1g.\n");
+                exit(-1);
+              }
+              break;
+    case 'm': lock_pages = 1; break;
+    case 'k': keep_pristine = 1; break;
+    case 'e': elastic_team = 1; break;
+    case 'x': if (!parseSchedule(optarg, schedule)) {
+                printerr("Schedule must be barrier, dataflow, steal or lookahead.\n");
+                exit(-1);
+              }
+              break;
+    case 'W': if (!parseBarrierKind(optarg, barrier_kind)) {
+                printerr("Barrier must be condvar or tree.\n");
+                exit(-1);
+              }
+              break;
+    case 'r': reps = atoi(optarg);
+              if (reps < 1) {
+                printerr("Runs must be at least 1.\n");
+                exit(-1);
+              }
+              break;
+    case 'D': lookahead_depth = atoi(optarg);
+              if (lookahead_depth < 1 || lookahead_depth > 3) {
+                printerr("Lookahead depth must be 1, 2 or 3.\n");
+                exit(-1);
+              }
+              break;
+    case 'L': if (!parseLayout(optarg, layout)) {
+                printerr("Layout must be column, blocked or morton.\n");
+                exit(-1);
+              }
+              break;
+    case 'K': if (!parseKernelBackend(optarg, kernel_backend)) {
+                printerr("Kernel backend must be scalar, avx2 or avx512.\n");
+                exit(-1);
+              }
+              if (!isKernelBackendSupported(kernel_backend)) {
+                printerr("This cpu does not support the requested kernel backend.\n");
+                exit(-1);
+              }
+              break;
+    case 'g': if (!parseMatrixClass(optarg, matrix_class)) {
+                printerr("Matrix class must be random, dominant, banded, blocksparse or spd.\n");
+                exit(-1);
+              }
+              generate_a = 1;
+              break;
+    case 'N': if (!parseNumaPolicy(optarg, numa_policy)) {
+                printerr("Numa policy must be local, interleave or owner.\n");
+                exit(-1);
+              }
+              break;
+    case 'T': trace_file = optarg; break;
+    case 'M': if (!loadMeshConfig(optarg, mesh_config)) {
+                printerr("Could not load mesh config.\n");
+                exit(-1);
+              }
+              break;
     case 'h': printf("Usage: LU <options>\n\n");
               printf("options:\n");
               printf("  -nN : Decompose NxN matrix.\n");
@@ -303,8 +489,28 @@ int main(int argc, char *argv[])
               printf("        good performance. Small block sizes (B=8, B=16) work well.\n");
               printf("  -c  : Copy non-locally allocated blocks to local memory before use.\n");
               printf("  -s  : Print individual processor timing statistics.\n");
+              printf("  -rR : Run each timed BM R times back to back and report the average.\n");
+              printf("  -e  : Shrink the team with the trailing matrix.\n");
               printf("  -t  : Test output.\n");
               printf("  -o  : Print out matrix values.\n");
+              printf("  -l  : Refine thread mapping to minimize maximum mesh link load.\n");
+              printf("  -TF : Record the address stream of the tracking pass to file F.\n");
+              printf("  -MF : Load mesh config F (written by calibrate).\n");
+              printf("  -OS : Give blocks to threads by S = cyclic, 2d, column, row, table:F, profile, graph\n");
+              printf("        or cha.\n");
+              printf("  -a  : CHA-aware block ownership instead of moving threads, same as -Ocha.\n");
+              printf("  -S  : Store blocks on CHAs near the core of their owner.\n");
+              printf("  -RK : Let bmod read panels from K replicas spread over the mesh.\n");
+              printf("  -HM : Back a and rhs with M = 4k, thp, 2m or 1g pages.\n");
+              printf("  -m  : mlock a and rhs.\n");
+              printf("  -NP : Owners first touch their blocks under numa policy P = local, interleave or owner.\n");
+              printf("  -gC : Generate a in parallel, C = random, dominant, banded, blocksparse or spd.\n");
+              printf("  -k  : Restore a from a pristine copy between runs.\n");
+              printf("  -LL : Store a in layout L = column, blocked or morton.\n");
+              printf("  -KK : Run the block kernels on backend K = scalar, avx2 or avx512.\n");
+              printf("  -xS : Schedule the block operations with S = barrier, dataflow, steal or lookahead.\n");
+              printf("  -DD : Factor panels up to D = 1, 2 or 3 trailing updates ahead with -xlookahead.\n");
+              printf("  -WB : Synchronize the team with barrier B = condvar or tree.\n");
               printf("  -h  : Print out command line options.\n\n");
               printf("Default: LU -n%1d -p%1d -b%1d\n",
                      DEFAULT_N,DEFAULT_P,DEFAULT_B);
@@ -315,15 +521,29 @@ int main(int argc, char *argv[])
 
   {__tid__[__threads__++]=pthread_self();}
 
+  if (schedule != Schedule::Barrier && replica_count > 0) {
+    /* a replica holds the panels of one step, the other schedules have several in flight */
+    printf("Panel replicas need the barrier schedule, ignoring -R.\n");
+    replica_count = 0;
+  }
+  if (schedule != Schedule::Barrier && elastic_team) {
+    printf("The elastic team needs the barrier schedule, ignoring -e.\n");
+    elastic_team = 0;
+  }
+
+  if (generate_a) {
+    generator = new MatrixGenerator(matrix_class, n, block_size);
+  }
+
   printf("\n");
   printf("Blocked Dense LU Factorization\n");
   printf("     %ld by %ld Matrix\n",n,n);
   printf("     %ld Processors\n",P);
   printf("     %ld by %ld Element Blocks\n",block_size,block_size);
-  printf("\n");
-  printf("\n");
+  block_kernels = getBlockKernels(kernel_backend, block_size);
+  printf("     %s Block Kernels%s\n", getKernelBackendName(kernel_backend),
+         isBlockSizeSpecialized(block_size) ? ", Specialized for the Block Size" : "");
 
-  // AYDIN: num_rows and num_cols are not used at the moment.
   num_rows = (long) sqrt((double) P);
   for (;;) {
     num_cols = P/num_rows;
@@ -331,6 +551,13 @@ int main(int argc, char *argv[])
       break;
     num_rows--;
   }
+  if (ownership == OwnershipStrategy::Grid) {
+    printf("     2d Block Ownership over a %ld by %ld Processor Grid\n", num_rows, num_cols);
+  } else {
+    printf("     %s Block Ownership\n", getOwnershipStrategyName(ownership));
+  }
+  printf("\n");
+  printf("\n");
 
 
 
@@ -339,15 +566,50 @@ int main(int argc, char *argv[])
     nblocks++;
   }
 
-  // a = (double *) malloc(n*n*sizeof(double));
-  const int ret = posix_memalign((void **)(&a), CACHELINE_SIZE, n*n*sizeof(double));
-  assert(ret == 0);
+  switch (ownership) {
+  case OwnershipStrategy::Grid:
+  case OwnershipStrategy::Column:
+  case OwnershipStrategy::Row:
+    block_owners = buildOwnerTable(ownership, nblocks, P, num_rows, num_cols);
+    break;
+  case OwnershipStrategy::Table:
+    if (!loadOwnerTable(owner_table_file, nblocks, P, block_owners)) {
+      printerr("Could not load the owner table.\n");
+      exit(-1);
+    }
+    break;
+  case OwnershipStrategy::Graph:
+    block_owners = buildGraphOwnership(nblocks, P);
+    break;
+  default:
+    break; /* round robin, -Ocha only changes the cha aware run, -Oprofile starts with it */
+  }
+  static_owners = block_owners;
+
+  a_size = getStorageSize(layout, n, block_size);
+  if (page_mode != PageMode::Default || lock_pages) {
+    /* with a numa policy the pages are first touched by their owners instead */
+    a_pages = allocatePages(a_size*sizeof(double), page_mode, numa_policy == NumaPolicy::None);
+    rhs_pages = allocatePages(n*sizeof(double), page_mode, numa_policy == NumaPolicy::None);
+    a = (double *) a_pages.address;
+    rhs = (double *) rhs_pages.address;
+  } else {
+    // a = (double *) malloc(n*n*sizeof(double));
+    const int ret = posix_memalign((void **)(&a), CACHELINE_SIZE, a_size*sizeof(double));
+    assert(ret == 0);
+    rhs = (double *) malloc(n*sizeof(double));;
+  }
 
   if (a == NULL) {
 	  printerr("Could not malloc memory for a.\n");
 	  exit(-1);
   }
-  rhs = (double *) malloc(n*sizeof(double));;
+  blocks = (double **) malloc(nblocks*nblocks*sizeof(double *));
+  if (blocks == NULL) {
+	  printerr("Could not malloc memory for blocks.\n");
+	  exit(-1);
+  }
+  LayoutBlocks();
   if (rhs == NULL) {
 	  printerr("Could not malloc memory for rhs.\n");
 	  exit(-1);
@@ -389,14 +651,6 @@ int main(int argc, char *argv[])
 	pthread_cond_init(&((Global->start).bar_cond), NULL);
 	(Global->start).bar_teller=0;
 };
-  {pthread_mutex_init(&(Global->idlock),NULL);};
-  Global->id = 0;
-
-  InitA(rhs);
-  if (doprint) {
-    printf("Matrix before decomposition:\n");
-    PrintA();
-  }
 
 
   std::cout << "base cores: ";
@@ -413,31 +667,68 @@ int main(int argc, char *argv[])
     std::cout << std::endl;
     assert(base_assigned_cores.size() == P);  
 
+  pool = new ThreadPool(P);
+  local_copies = (struct LocalCopies **) calloc(P, sizeof(struct LocalCopies *));
+  tlb_counters = (TlbMissCounter **) calloc(P, sizeof(TlbMissCounter *));
+  tlb_miss_counts = (long long *) calloc(P, sizeof(long long));
+  if (local_copies == NULL || tlb_counters == NULL || tlb_miss_counts == NULL) {
+    printerr("Could not malloc memory for local_copies or the TLB counters.\n");
+    exit(-1);
+  }
+
+  if (numa_policy != NumaPolicy::None) {
+    PlaceA(base_assigned_cores.data());
+  }
+  if (a_pages.address != NULL) {
+    if (lock_pages) {
+      lockPages(a_pages);
+      lockPages(rhs_pages);
+    }
+    printPageReport("a", a_pages);
+    printPageReport("rhs", rhs_pages);
+    printTlbMissDifference(a_pages);
+  }
+
+  if (generator != NULL) {
+    RunTeam(GenerateA, base_assigned_cores.data());
+  } else {
+    InitA(rhs);
+  }
+  if (keep_pristine) {
+    pristine = (double *) malloc(nblocks*nblocks*block_size*block_size*sizeof(double));
+    if (pristine == NULL) {
+      printerr("Could not malloc memory for the pristine copy of a.\n");
+      exit(-1);
+    }
+    RunTeam(SnapshotA, base_assigned_cores.data());
+  }
+  if (ownership == OwnershipStrategy::Profile) {
+    ProfileOwnership(base_assigned_cores.data());
+  }
+  if (doprint) {
+    printf("Matrix before decomposition:\n");
+    PrintA();
+  }
+
   // ADDRESS-THREAD_ID TRACKING STARTS HERE.
   std::cout << "Starting address tracking..." << std::endl;
   const auto address_tracking_start = high_resolution_clock::now();
-	assert(__threads__<__MAX_THREADS__);
-	pthread_mutex_lock(&__intern__);
-	for (int i = 0; i < (P) - 1; i++) {
-		const int Error = pthread_create(&__tid__[__threads__++], NULL, SlaveStart, static_cast<void*>(base_assigned_cores.data()));
-		if (Error != 0) {
-			printf("Error in pthread_create().\n");
-			exit(-1);
-		}
-	}
-	pthread_mutex_unlock(&__intern__);
-
-	SlaveStart(static_cast<void*>(base_assigned_cores.data()));
-  std::cout << "WAITING FOR JOIN..." << std::endl;
-  {int aantal=P; while (aantal--) pthread_join(__tid__[aantal], NULL);};
-  std::cout << "AFTER JOIN" << std::endl;  
+  if (trace_file != NULL) {
+    trace = new TraceWriter(trace_file, n, block_size, P);
+  }
+  tracking = 1;
+  PrepareTeam(base_assigned_cores.data(), 0); // the map is of the full team.
+  RunTeam(SlaveStart, base_assigned_cores.data());
+  tracking = 0;
+  if (trace != NULL) {
+    trace->close(getuid() == 0); // homes can only be hashed with access to the pagemap.
+    delete trace;
+    trace = NULL;
+  }
 
   const auto address_tracking_end = high_resolution_clock::now();
   std::cout << "Ended address tracking. elapsed time: " << duration_cast<milliseconds>(address_tracking_end - address_tracking_start).count() << "ms" << std::endl;
-  Global->id = 0; // reset the id.
-  __threads__ = 0; // reset this, too.
-  (Global->start).bar_teller=0; // reset.
-  InitA(rhs); // reset.
+  ResetA(base_assigned_cores.data()); // reset.
 
   // ADDRESS-THREAD_ID TRACKING IS DONE.
 
@@ -520,7 +811,7 @@ int main(int argc, char *argv[])
     std::vector<int> thread_to_core(P, -1);
 
     // fprintf(stderr, "before topology creation\n");
-    auto topo = Topology(cha_core_map, CAPID6);
+    auto topo = Topology(mesh_config);
     std::vector<Tile> mapped_tiles;
     // SPDLOG_TRACE("~~~~~~~~~~~~~~~~");
     //  fprintf(stderr, "before thread mapping creation\n");
@@ -596,6 +887,20 @@ int main(int argc, char *argv[])
     }
     // end
 
+    {
+        CongestionModel congestion(topo);
+        congestion.addTransfers(buildTransfers(total_cha_freq_count_t1_t2, base_assigned_cores));
+        congestion.printReport("base");
+
+        if (minimize_link_load) {
+            minimizeMaxLinkLoad(topo, total_cha_freq_count_t1_t2, thread_to_core);
+        }
+
+        congestion.reset();
+        congestion.addTransfers(buildTransfers(total_cha_freq_count_t1_t2, thread_to_core));
+        congestion.printReport("cha aware");
+    }
+
 
     const auto algo_end = high_resolution_clock::now();
     std::cout << "Ended preprocesing algo. elapsed time: " << duration_cast<milliseconds>(algo_end - algo_start).count() << "ms" << std::endl;
@@ -615,34 +920,56 @@ int main(int argc, char *argv[])
 
   // cha aware BM.
   std::cout << "Now running cha aware BM" << std::endl;
-	assert(__threads__<__MAX_THREADS__);
-
-  const auto cha_aware_start = high_resolution_clock::now();
-	pthread_mutex_lock(&__intern__);
-	for (int i = 0; i < (P) - 1; i++) {
-		const int Error = pthread_create(&__tid__[__threads__++], NULL, SlaveStart, static_cast<void*>(thread_to_core.data()));
-		if (Error != 0) {
-			printf("Error in pthread_create().\n");
-			exit(-1);
-		}
-	}
-	pthread_mutex_unlock(&__intern__);
-
-	SlaveStart(static_cast<void*>(thread_to_core.data()));
-
 
-  // std::cout << "WAITING FOR JOIN..." << std::endl;
-  {int aantal=P; while (aantal--) pthread_join(__tid__[aantal], NULL);};
-  // std::cout << "AFTER JOIN. ended cha aware bm" << std::endl;
+  int *cha_aware_cores = thread_to_core.data();
+  if (ownership == OwnershipStrategy::Cha) {
+    block_owners = buildChaAwareOwnership(blocks, block_stride, n, block_size, base_assigned_cores, topo);
+    cha_aware_cores = base_assigned_cores.data(); // threads stay, blocks move.
+  }
+  SliceAllocator *slice_allocator = NULL;
+  if (slice_colored) {
+    slice_allocator = new SliceAllocator(topo, block_size*block_size*sizeof(double), nblocks*nblocks);
+    SliceColoredBlocks(slice_allocator, cha_aware_cores);
+    slice_allocator->releaseUnused();
+    slice_allocator->printStats();
+    ResetA(base_assigned_cores.data());
+  }
+  SliceAllocator *replica_allocator = NULL;
+  if (replica_count > 0) {
+    const auto plan = planReplicas(topo, std::vector<int>(cha_aware_cores, cha_aware_cores + P), replica_count);
+    replica_count = plan.anchor_cores.size();
+    replica_allocator = new SliceAllocator(topo, block_size*block_size*sizeof(double), replica_count*2*nblocks);
+    AllocateReplicas(replica_allocator, plan);
+    replica_allocator->releaseUnused();
+    replica_allocator->printStats();
+  }
 
-  const auto cha_aware_end = high_resolution_clock::now();
-  const auto elapsed_cha_aware = duration_cast<milliseconds>(cha_aware_end - cha_aware_start).count();
+  PrepareTeam(cha_aware_cores, elastic_team);
+  high_resolution_clock::duration cha_aware_time{};
+  for (long r = 0; r < reps; r++) {
+    if (r > 0) {
+      ResetA(cha_aware_cores); // the same threads, untimed.
+    }
+    const auto cha_aware_start = high_resolution_clock::now();
+    RunTeam(CountedSlaveStart, cha_aware_cores);
+    cha_aware_time += high_resolution_clock::now() - cha_aware_start;
+  }
+  const long long tlb_misses_cha_aware = SumTlbMisses();
+  const auto elapsed_cha_aware = duration_cast<milliseconds>(cha_aware_time).count() / reps;
   std::cout << "Ended cha aware BM. elapsed time: " << elapsed_cha_aware << "ms" << std::endl;
 
-  Global->id = 0; // reset the id.
-  __threads__ = 0; // reset this, too.
-  (Global->start).bar_teller=0; // reset.
-  InitA(rhs); // reset.
+  block_owners = static_owners; // back to the -O ownership.
+  if (slice_allocator != NULL) {
+    LayoutBlocks(); // base BM runs on a.
+    delete slice_allocator;
+  }
+  if (replica_allocator != NULL) {
+    free(replica_blocks);
+    replica_blocks = NULL; // base BM reads the panels in place.
+    free(thread_replica);
+    delete replica_allocator;
+  }
+  ResetA(base_assigned_cores.data()); // reset.
   // END OF cha aware BM.
 
 
@@ -653,36 +980,27 @@ int main(int argc, char *argv[])
 
   // base BM.
   std::cout << "Now running base BM" << std::endl;
-	assert(__threads__<__MAX_THREADS__);
-
-  const auto base_start = high_resolution_clock::now();
-	pthread_mutex_lock(&__intern__);
-	for (int i = 0; i < (P) - 1; i++) {
-		const int Error = pthread_create(&__tid__[__threads__++], NULL, SlaveStart, static_cast<void*>(base_assigned_cores.data()));
-		if (Error != 0) {
-			printf("Error in pthread_create().\n");
-			exit(-1);
-		}
-	}
-	pthread_mutex_unlock(&__intern__);
-
-	SlaveStart(static_cast<void*>(base_assigned_cores.data()));
-
-
-  // std::cout << "WAITING FOR JOIN..." << std::endl;
-  {int aantal=P; while (aantal--) pthread_join(__tid__[aantal], NULL);};
-  // std::cout << "AFTER JOIN. ended base bm" << std::endl;
 
-  const auto base_end = high_resolution_clock::now();
-  const auto elapsed_base = duration_cast<milliseconds>(base_end - base_start).count();
+  PrepareTeam(base_assigned_cores.data(), elastic_team);
+  high_resolution_clock::duration base_time{};
+  for (long r = 0; r < reps; r++) {
+    if (r > 0) {
+      ResetA(base_assigned_cores.data());
+    }
+    const auto base_start = high_resolution_clock::now();
+    RunTeam(CountedSlaveStart, base_assigned_cores.data());
+    base_time += high_resolution_clock::now() - base_start;
+  }
+  const long long tlb_misses_base = SumTlbMisses();
+  const auto elapsed_base = duration_cast<milliseconds>(base_time).count() / reps;
   std::cout << "Ended base BM. elapsed time: " << elapsed_base << "ms" << std::endl;
+  if (tlb_counters[0]->isAvailable()) {
+    std::cout << "dTLB misses. cha aware BM: " << tlb_misses_cha_aware / reps << ", base BM: " << tlb_misses_base / reps << std::endl;
+  }
 
 
   // NO NEED TO RESET FROM NOW ON!
-  // Global->id = 0; // reset the id.
-  // __threads__ = 0; // reset this, too.
-  // (Global->start).bar_teller=0; // reset.
-  // InitA(rhs); // reset.
+  // ResetA(base_assigned_cores.data()); // reset.
 
   // END OF base BM.
 
@@ -785,84 +1103,289 @@ int main(int argc, char *argv[])
 
   if (test_result) {
     printf("                             TESTING RESULTS\n");
-    CheckResult(n, a, rhs);
+    if (layout == Layout::Column) {
+      CheckResult(n, a, rhs);
+    } else {
+      double *column_major = (double *) malloc(n*n*sizeof(double));
+      if (column_major == NULL) {
+        printerr("Could not malloc memory for the column major copy of a.\n");
+        exit(-1);
+      }
+      ToColumnMajor(column_major);
+      CheckResult(n, column_major, rhs);
+      free(column_major);
+    }
   }
 
   {exit(0);};
 }
 
-void* SlaveStart(void* data)
+/* sets the numa policy of a and rhs up and lets every thread, pinned like
+   in the tracking and base runs, first touch the blocks BlockOwner gives it. */
+void PlaceA(int *cores)
 {
-  assert(data);
+  long I, J, j;
+
+  switch (numa_policy) {
+  case NumaPolicy::Local:
+    localPages(a, a_size*sizeof(double));
+    break;
+  case NumaPolicy::Interleave:
+    interleavePages(a, a_size*sizeof(double));
+    interleavePages(rhs, n*sizeof(double));
+    break;
+  case NumaPolicy::Owner: {
+    PageNodeVotes votes(a, a_size*sizeof(double));
+    for (J=0; J<nblocks; J++) {
+      for (I=0; I<nblocks; I++) {
+        const int node = getCoreNode(cores[BlockOwner(I, J)]);
+        for (j=0; j<block_size && J*block_size+j<n; j++) {
+          votes.add(&(blocks[I+J*nblocks][j*block_stride]), min(block_size, n-I*block_size)*sizeof(double), node);
+        }
+      }
+    }
+    votes.bind();
+    break;
+  }
+  default:
+    break;
+  }
 
-  int* cores = static_cast<int*>(data);
-  // std::cout << "cores: ";
-  // for(int i = 0; i < 28; ++i) {
-  //   std::cout << i << ' ';
-  // }
-  // std::cout << std::endl;
-  // return nullptr;
+  RunTeam(FirstTouchA, cores);
+  printNodeReport("a", a, a_size*sizeof(double));
+}
 
-  long MyNum;
 
-  {pthread_mutex_lock(&(Global->idlock));}
-    MyNum = Global->id;
-    Global->id ++;
-  {pthread_mutex_unlock(&(Global->idlock));}
+/* runs work(MyNum) on the P threads of the pool, pinned to cores. */
+void RunTeam(void (*work)(long MyNum), int *cores)
+{
+  team_cores = cores;
+  pool->run(std::vector<int>(cores, cores + P), work);
+}
 
-  // std::cout << "id: " << MyNum << ", core: " << cores[static_cast<int>(MyNum)] << std::endl;
 
-  stick_this_thread_to_core(cores[static_cast<int>(MyNum)]);
+void FirstTouchA(long MyNum)
+{
+  long i, j, I, J;
+  double *A;
 
-  OneSolve(n, block_size, MyNum, dostats);
+  for (J=0; J<nblocks; J++) {
+    for (I=0; I<nblocks; I++) {
+      if (BlockOwner(I, J) == MyNum) {
+        A = blocks[I+J*nblocks];
+        for (j=0; j<block_size && J*block_size+j<n; j++) {
+          for (i=0; i<block_size && I*block_size+i<n; i++) {
+            A[i+j*block_stride] = 0.0;
+          }
+        }
+      }
+    }
+  }
+  if (MyNum == 0) {
+    for (i=0; i<n; i++) {
+      rhs[i] = 0.0;
+    }
+  }
+}
+
+
+/* owned blocks from the generator, and rows [MyNum*n/P, (MyNum+1)*n/P) of
+   rhs summed in the same order as InitA does. */
+void GenerateA(long MyNum)
+{
+  long i, j, I, J;
+  double *A;
 
-  // std::cout << "END OF THREAD: #" << MyNum << std::endl;
-  return nullptr;
+  for (J=0; J<nblocks; J++) {
+    for (I=0; I<nblocks; I++) {
+      if (BlockOwner(I, J) == MyNum) {
+        A = blocks[I+J*nblocks];
+        for (j=0; j<block_size && J*block_size+j<n; j++) {
+          for (i=0; i<block_size && I*block_size+i<n; i++) {
+            A[i+j*block_stride] = generator->get(I*block_size+i, J*block_size+j);
+          }
+        }
+      }
+    }
+  }
+  for (i=MyNum*n/P; i<(MyNum+1)*n/P; i++) {
+    rhs[i] = 0.0;
+    for (j=0; j<n; j++) {
+      rhs[i] += generator->get(i, j);
+    }
+  }
+}
+
+
+void SnapshotA(long MyNum)
+{
+  long i, j, I, J;
+  double *A, *S;
+
+  for (J=0; J<nblocks; J++) {
+    for (I=0; I<nblocks; I++) {
+      if (BlockOwner(I, J) == MyNum) {
+        A = blocks[I+J*nblocks];
+        S = &(pristine[(I+J*nblocks)*block_size*block_size]);
+        for (j=0; j<block_size && J*block_size+j<n; j++) {
+          for (i=0; i<block_size && I*block_size+i<n; i++) {
+            S[i+j*block_size] = A[i+j*block_stride];
+          }
+        }
+      }
+    }
+  }
 }
 
 
-void OneSolve(long n, long block_size, long MyNum, long dostats)
+void RestoreA(long MyNum)
+{
+  long i, j, I, J;
+  double *A, *S;
+
+  for (J=0; J<nblocks; J++) {
+    for (I=0; I<nblocks; I++) {
+      if (BlockOwner(I, J) == MyNum) {
+        A = blocks[I+J*nblocks];
+        S = &(pristine[(I+J*nblocks)*block_size*block_size]);
+        for (j=0; j<block_size && J*block_size+j<n; j++) {
+          for (i=0; i<block_size && I*block_size+i<n; i++) {
+            A[i+j*block_stride] = S[i+j*block_size];
+          }
+        }
+      }
+    }
+  }
+}
+
+
+/* puts a back to its state before decomposition. rhs never changes. */
+void ResetA(int *cores)
+{
+  if (pristine != NULL) {
+    RunTeam(RestoreA, cores);
+  } else if (generator != NULL) {
+    RunTeam(GenerateA, cores);
+  } else {
+    InitA(rhs);
+  }
+}
+
+
+/* -Oprofile: times every block task of a barrier schedule run on cores,
+   outside of the timed runs, and gives the blocks to threads by those
+   times from then on. */
+void ProfileOwnership(int *cores)
+{
+  const Schedule run_schedule = schedule;
+
+  profile = new TaskProfile(nblocks);
+  schedule = Schedule::Barrier;
+  PrepareTeam(cores, elastic_team);
+  RunTeam(SlaveStart, cores);
+  schedule = run_schedule;
+
+  block_owners = buildProfiledOwnership(*profile, P);
+  static_owners = block_owners;
+  delete profile;
+  profile = NULL;
+  ResetA(cores);
+}
+
+
+double Seconds(void)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void SlaveStart(long MyNum)
+{
+  OneSolve(n, block_size, MyNum, dostats, team_cores);
+}
+
+
+/* SlaveStart of the timed runs, counting the dTLB misses of the thread.
+   a pool thread outlives the runs, so it opens its own counter instead
+   of inheriting one from main. */
+void CountedSlaveStart(long MyNum)
+{
+  if (tlb_counters[MyNum] == NULL) {
+    tlb_counters[MyNum] = new TlbMissCounter();
+  }
+  tlb_counters[MyNum]->start();
+  SlaveStart(MyNum);
+  tlb_miss_counts[MyNum] += tlb_counters[MyNum]->stop();
+}
+
+
+/* dTLB misses of all threads since the last call. */
+long long SumTlbMisses(void)
+{
+  long long total = 0;
+  for (long i = 0; i < P; i++) {
+    total += tlb_miss_counts[i];
+    tlb_miss_counts[i] = 0;
+  }
+  return total;
+}
+
+
+void OneSolve(long n, long block_size, long MyNum, long dostats, int *cores)
 {
   unsigned long myrs, myrf, mydone;
   struct LocalCopies *lc;
 
-  lc = (struct LocalCopies *) malloc(sizeof(struct LocalCopies));
+  lc = local_copies[MyNum];
   if (lc == NULL) {
-    fprintf(stderr,"Proc %ld could not malloc memory for lc\n",MyNum);
-    exit(-1);
+    lc = (struct LocalCopies *) malloc(sizeof(struct LocalCopies));
+    if (lc == NULL) {
+      fprintf(stderr,"Proc %ld could not malloc memory for lc\n",MyNum);
+      exit(-1);
+    }
+    lc->arena = NULL;
+    lc->arena_step = NULL;
+    if (copy_local) {
+      /* allocated by the thread itself so that first touch keeps it local */
+      if (posix_memalign((void **)(&lc->arena), CACHELINE_SIZE, 2*nblocks*block_size*block_size*sizeof(double)) != 0 ||
+          (lc->arena_step = (long *) malloc(2*nblocks*sizeof(long))) == NULL) {
+        fprintf(stderr,"Proc %ld could not malloc memory for its arena\n",MyNum);
+        exit(-1);
+      }
+      memset(lc->arena, 0, 2*nblocks*block_size*block_size*sizeof(double));
+    }
+    local_copies[MyNum] = lc;
   }
   lc->t_in_fac = 0.0;
   lc->t_in_solve = 0.0;
   lc->t_in_mod = 0.0;
   lc->t_in_bar = 0.0;
+  if (lc->arena != NULL) {
+    /* the copies are of the previous run's a */
+    for (long slot = 0; slot < 2*nblocks; slot++) {
+      lc->arena_step[slot] = -1;
+    }
+  }
+
+  if (MyNum == 0 && (schedule == Schedule::Dataflow || schedule == Schedule::Steal)) {
+    std::vector<std::vector<long>> victims;
+    if (schedule == Schedule::Steal) {
+      Topology topo(mesh_config);
+      victims = getStealOrder(topo, std::vector<int>(cores, cores + P));
+    }
+    dataflow = new DataflowScheduler(nblocks, P, BlockOwnerTable(), victims);
+  }
+  if (MyNum == 0 && schedule == Schedule::Lookahead) {
+    lookahead = new LookaheadProgress(nblocks, lookahead_depth);
+  }
 
   /* barrier to ensure all initialization is done */
-  {
-pthread_mutex_lock(&((Global->start).bar_mutex));
-(Global->start).bar_teller++;
-if ((Global->start).bar_teller == (P)) {
-	(Global->start).bar_teller = 0;
-	pthread_cond_broadcast(&((Global->start).bar_cond));
-} else {
-	pthread_cond_wait(&((Global->start).bar_cond), &((Global->start).bar_mutex));
-}
-pthread_mutex_unlock(&((Global->start).bar_mutex));}
-;
+  Barrier(MyNum);
 
   /* to remove cold-start misses, all processors begin by touching a[] */
   TouchA(block_size, MyNum);
 
-  {
-pthread_mutex_lock(&((Global->start).bar_mutex));
-(Global->start).bar_teller++;
-if ((Global->start).bar_teller == (P)) {
-	(Global->start).bar_teller = 0;
-	pthread_cond_broadcast(&((Global->start).bar_cond));
-} else {
-	pthread_cond_wait(&((Global->start).bar_cond), &((Global->start).bar_mutex));
-}
-pthread_mutex_unlock(&((Global->start).bar_mutex));}
-;
+  Barrier(MyNum);
 
 /* POSSIBLE ENHANCEMENT:  Here is where one might reset the
    statistics that one is measuring about the parallel execution */
@@ -877,17 +1400,7 @@ pthread_mutex_unlock(&((Global->start).bar_mutex));}
     {long time{}; (mydone) = ::time(0);};
   }
 
-  {
-pthread_mutex_lock(&((Global->start).bar_mutex));
-(Global->start).bar_teller++;
-if ((Global->start).bar_teller == (P)) {
-	(Global->start).bar_teller = 0;
-	pthread_cond_broadcast(&((Global->start).bar_cond));
-} else {
-	pthread_cond_wait(&((Global->start).bar_cond), &((Global->start).bar_mutex));
-}
-pthread_mutex_unlock(&((Global->start).bar_mutex));}
-;
+  Barrier(MyNum);
 
   if ((MyNum == 0) || (dostats)) {
     {long time{}; (myrf) = ::time(0);};
@@ -901,6 +1414,89 @@ pthread_mutex_unlock(&((Global->start).bar_mutex));}
     Global->rs = myrs;
     Global->done = mydone;
     Global->rf = myrf;
+    if (schedule == Schedule::Steal) {
+      printf("Stolen updates per thread:");
+      for (long t = 0; t < P; t++) {
+        printf(" %ld", dataflow->getStealCount(t));
+      }
+      printf("\n");
+    }
+    delete dataflow;
+    dataflow = NULL;
+    delete lookahead;
+    lookahead = NULL;
+  }
+}
+
+
+/* the barrier of the team about to start on cores, shaped by their tiles
+   with -Wtree, and if shrink its shrinking teams. those keep the threads
+   closest to the CHAs of the blocks left once the team first shrinks.
+   a map that left threads without a core keeps the full team. */
+void PrepareTeam(int *cores, long shrink)
+{
+  Topology topo(mesh_config);
+  const std::vector<int> thread_to_core(cores, cores + P);
+
+  delete tree_barrier;
+  tree_barrier = NULL;
+  if (barrier_kind == BarrierKind::Tree) {
+    tree_barrier = new TreeBarrier(topo, thread_to_core);
+  }
+
+  delete elastic;
+  elastic = NULL;
+  if (shrink && std::count(thread_to_core.begin(), thread_to_core.end(), -1) > 0) {
+    printf("Some threads have no core, running the full team.\n");
+    shrink = 0;
+  }
+  if (shrink) {
+    const std::vector<long> sizes = getElasticTeamSizes(n, block_size, P);
+    long shell = 0;
+    while (shell < nblocks && sizes[shell] == P) {
+      shell++;
+    }
+    std::map<int, int> tail;
+    if (shell < nblocks) {
+      for (const auto &histogram : getBlockChaHistograms(blocks, block_stride, n, block_size, shell)) {
+        for (const auto &[cha, count] : histogram) {
+          tail[cha] += count;
+        }
+      }
+    }
+    elastic = new ElasticTeam(sizes, orderThreadsByChaCost(topo, thread_to_core, tail), barrier_kind, topo, thread_to_core);
+  }
+}
+
+
+/* all P threads of the team meet here. */
+void Barrier(long MyNum)
+{
+  if (tree_barrier != NULL) {
+    tree_barrier->wait(MyNum);
+    return;
+  }
+  {
+pthread_mutex_lock(&((Global->start).bar_mutex));
+(Global->start).bar_teller++;
+if ((Global->start).bar_teller == (P)) {
+	(Global->start).bar_teller = 0;
+	pthread_cond_broadcast(&((Global->start).bar_cond));
+} else {
+	pthread_cond_wait(&((Global->start).bar_cond), &((Global->start).bar_mutex));
+}
+pthread_mutex_unlock(&((Global->start).bar_mutex));}
+;
+}
+
+
+/* the barrier of step K, only the step's team meets with -e. */
+void StepBarrier(long MyNum, long K)
+{
+  if (elastic != NULL) {
+    elastic->wait(MyNum, K);
+  } else {
+    Barrier(MyNum);
   }
 }
 
@@ -910,12 +1506,22 @@ void lu0(double *a, long n, long stride, long MyNum)
   long j, k, length;
   double alpha;
 
+  if (!tracking) {
+    block_kernels.factor_diagonal(a, n, stride);
+    return;
+  }
+
   for (k=0; k<n; k++) {
     /* modify subsequent columns */
     for (j=k+1; j<n; j++) {
       a[k+j*stride] /= a[k+k*stride]; // a written
 
-      {
+      if (trace != NULL) {
+        trace->record(MyNum, &a[k+k*stride], false);
+        trace->record(MyNum, &a[k+j*stride], true);
+      }
+
+      if (tracking) {
         std::lock_guard lock(map_mutex);
         threadid_addresses_map[MyNum].insert(&a[k+j*stride]);
       }
@@ -933,9 +1539,17 @@ void bdiv(double *a, double *diag, long stride_a, long stride_diag, long dimi, l
   long j, k;
   double alpha;
 
+  if (!tracking) {
+    block_kernels.solve_column_panel(a, diag, stride_a, stride_diag, dimi, dimk);
+    return;
+  }
+
   for (k=0; k<dimk; k++) {
     for (j=k+1; j<dimk; j++) {
       alpha = -diag[k+j*stride_diag];
+      if (trace != NULL) {
+        trace->record(MyNum, &diag[k+j*stride_diag], false);
+      }
       daxpy(&a[j*stride_a], &a[k*stride_a], dimi, alpha, MyNum);
     }
   }
@@ -947,11 +1561,21 @@ void bmodd(double *a, double *c, long dimi, long dimj, long stride_a, long strid
   long j, k, length;
   double alpha;
 
+  if (!tracking) {
+    block_kernels.solve_row_panel(a, c, dimi, dimj, stride_a, stride_c);
+    return;
+  }
+
   for (k=0; k<dimi; k++)
     for (j=0; j<dimj; j++) {
       c[k+j*stride_c] /= a[k+k*stride_a]; // a written
 
-      {
+      if (trace != NULL) {
+        trace->record(MyNum, &a[k+k*stride_a], false);
+        trace->record(MyNum, &c[k+j*stride_c], true);
+      }
+
+      if (tracking) {
         std::lock_guard lock(map_mutex);
         threadid_addresses_map[MyNum].insert(&c[k+j*stride_c]);
       }
@@ -963,15 +1587,24 @@ void bmodd(double *a, double *c, long dimi, long dimj, long stride_a, long strid
 }
 
 
-void bmod(double *a, double *b, double *c, long dimi, long dimj, long dimk, long stride, long MyNum)
+void bmod(double *a, double *b, double *c, long dimi, long dimj, long dimk, long stride_a, long stride_b, long stride_c, long MyNum)
 {
   long j, k;
   double alpha;
 
+  if (!tracking) {
+    /* packed register-blocked c -= a*b, the element-wise loop below is the instrumented reference */
+    block_kernels.gemm_subtract(dimi, dimj, dimk, a, stride_a, b, stride_b, c, stride_c);
+    return;
+  }
+
   for (k=0; k<dimk; k++) {
     for (j=0; j<dimj; j++) {
-      alpha = -b[k+j*stride];
-      daxpy(&c[j*stride], &a[k*stride], dimi, alpha, MyNum);
+      alpha = -b[k+j*stride_b];
+      if (trace != NULL) {
+        trace->record(MyNum, &b[k+j*stride_b], false);
+      }
+      daxpy(&c[j*stride_c], &a[k*stride_a], dimi, alpha, MyNum);
     }
   }
 }
@@ -984,7 +1617,12 @@ void daxpy(double *a, double *b, long n, double alpha, long MyNum)
   for (i=0; i<n; i++) {
     a[i] += alpha*b[i]; // a written
 
-    {
+    if (trace != NULL) {
+      trace->record(MyNum, &b[i], false);
+      trace->record(MyNum, &a[i], true);
+    }
+
+    if (tracking) {
       std::lock_guard lock(map_mutex);
       threadid_addresses_map[MyNum].insert(&a[i]);
     }
@@ -994,87 +1632,131 @@ void daxpy(double *a, double *b, long n, double alpha, long MyNum)
 
 long BlockOwner(long I, long J)
 {
-//	return((I%num_cols) + (J%num_rows)*num_cols);
+  if (!block_owners.empty()) {
+    return(block_owners[I + J*nblocks]);
+  }
 	return((I + J*nblocks) % P);
 }
 
-long BlockOwnerColumn(long I, long J)
+/* the thread working on block (I, J) in step K. with -e a block whose
+   owner is parked goes round robin over the step's team. */
+long StepOwner(long I, long J, long K)
 {
-	return(I % P);
-}
+  const long owner = BlockOwner(I, J);
 
-long BlockOwnerRow(long I, long J)
-{
-	return(((J % P) + (P / 2)) % P);
+  if (elastic == NULL || elastic->isActive(owner, K)) {
+    return(owner);
+  }
+  return(elastic->getMember((I + J*nblocks) % elastic->getTeamSize(K)));
 }
 
 void lu(long n, long bs, long MyNum, struct LocalCopies *lc, long dostats)
 {
   long i, il, j, jl, k, kl, I, J, K;
   double *A, *B, *C, *D; // AYDIN: these will be assigned to addresses of A. so, treat accesses to these as accesses to A.
-  long strI;
+  double *AL;        /* A as bmod reads it, a local copy with -c */
+  double **panels;   /* this thread's panel replica, NULL to read the panels in place */
+  long strI, strP, strA, strB;
   unsigned long t1, t2, t3, t4, t11, t22;
+  double ts = 0.0;   /* start of the block task with -Oprofile */
 
-  strI = n;
+  if (dataflow != NULL) {
+    DataflowLu(n, bs, MyNum, lc, dostats);
+    return;
+  }
+  if (lookahead != NULL) {
+    LookaheadLu(n, bs, MyNum, lc, dostats);
+    return;
+  }
+
+  strI = block_stride;
+  panels = NULL;
+  strP = strI;
+  if (replica_blocks != NULL) {
+    panels = &(replica_blocks[thread_replica[MyNum]*2*nblocks]);
+    strP = block_size;
+  }
   for (k=0, K=0; k<n; k+=bs, K++) {
     kl = k+bs; 
     if (kl>n) {
       kl = n;
     }
 
+    if (elastic != NULL) {
+      if (K > 0 && elastic->getTeamSize(K) < elastic->getTeamSize(K-1)) {
+        /* the old team, so that the leaving threads' updates are done */
+        StepBarrier(MyNum, K-1);
+      }
+      if (!elastic->isActive(MyNum, K)) {
+        break; /* parked in the last barrier of OneSolve */
+      }
+    }
+
     if ((MyNum == 0) || (dostats)) {
       {long time{}; (t1) = ::time(0);};
     }
 
     /* factor diagonal block */
-    if (BlockOwner(K, K) == MyNum) {
-      A = &(a[k+k*n]); 
+    if (StepOwner(K, K, K) == MyNum) {
+      A = blocks[K+K*nblocks];
+      if (profile != NULL) {
+        ts = Seconds();
+      }
       lu0(A, kl-k, strI, MyNum);
+      if (profile != NULL) {
+        profile->setLast(K, K, Seconds()-ts);
+      }
     }
 
     if ((MyNum == 0) || (dostats)) {
       {long time{}; (t11) = ::time(0);};
     }
 
-    {
-pthread_mutex_lock(&((Global->start).bar_mutex));
-(Global->start).bar_teller++;
-if ((Global->start).bar_teller == (P)) {
-	(Global->start).bar_teller = 0;
-	pthread_cond_broadcast(&((Global->start).bar_cond));
-} else {
-	pthread_cond_wait(&((Global->start).bar_cond), &((Global->start).bar_mutex));
-}
-pthread_mutex_unlock(&((Global->start).bar_mutex));}
-;
+    StepBarrier(MyNum, K);
 
     if ((MyNum == 0) || (dostats)) {
       {long time{}; (t2) = ::time(0);};
     }
 
     /* divide column k by diagonal block */
-    D = &(a[k+k*n]);
+    D = blocks[K+K*nblocks];
     for (i=kl, I=K+1; i<n; i+=bs, I++) {
-      if (BlockOwner/*Column*/(I, K) == MyNum) {  /* parcel out blocks */
-	      /*if (K == 0) printf("C%lx\n", BlockOwnerColumn(I, K));*/
+      if (StepOwner(I, K, K) == MyNum) {  /* parcel out blocks */
         il = i + bs;
         if (il > n) {
           il = n;
         }
-        A = &(a[i+k*n]);
-        bdiv(A, D, strI, n, il-i, kl-k, MyNum);
+        A = blocks[I+K*nblocks];
+        if (profile != NULL) {
+          ts = Seconds();
+        }
+        bdiv(A, D, strI, strI, il-i, kl-k, MyNum);
+        if (profile != NULL) {
+          profile->setLast(I, K, Seconds()-ts);
+        }
+        if (replica_blocks != NULL) {
+          CopyToReplicas(A, strI, il-i, kl-k, I);
+        }
       }
     }
     /* modify row k by diagonal block */
     for (j=kl, J=K+1; j<n; j+=bs, J++) {
-      if (BlockOwner/*Row*/(K, J) == MyNum) {  /* parcel out blocks */
-	      /*if (K == 0) printf("R%lx\n", BlockOwnerRow(K, J));*/
+      if (StepOwner(K, J, K) == MyNum) {  /* parcel out blocks */
         jl = j+bs;
         if (jl > n) {
           jl = n;
         }
-        A = &(a[k+j*n]);
-        bmodd(D, A, kl-k, jl-j, n, strI, MyNum);
+        A = blocks[K+J*nblocks];
+        if (profile != NULL) {
+          ts = Seconds();
+        }
+        bmodd(D, A, kl-k, jl-j, strI, strI, MyNum);
+        if (profile != NULL) {
+          profile->setLast(K, J, Seconds()-ts);
+        }
+        if (replica_blocks != NULL) {
+          CopyToReplicas(A, strI, kl-k, jl-j, nblocks+J);
+        }
       }
     }
 
@@ -1082,17 +1764,7 @@ pthread_mutex_unlock(&((Global->start).bar_mutex));}
       {long time{}; (t22) = ::time(0);};
     }
 
-    {
-pthread_mutex_lock(&((Global->start).bar_mutex));
-(Global->start).bar_teller++;
-if ((Global->start).bar_teller == (P)) {
-	(Global->start).bar_teller = 0;
-	pthread_cond_broadcast(&((Global->start).bar_cond));
-} else {
-	pthread_cond_wait(&((Global->start).bar_cond), &((Global->start).bar_mutex));
-}
-pthread_mutex_unlock(&((Global->start).bar_mutex));}
-;
+    StepBarrier(MyNum, K);
 
     if ((MyNum == 0) || (dostats)) {
       {long time{}; (t3) = ::time(0);};
@@ -1104,17 +1776,29 @@ pthread_mutex_unlock(&((Global->start).bar_mutex));}
       if (il > n) {
         il = n;
       }
-      A = &(a[i+k*n]);
+      A = (panels != NULL) ? panels[I] : blocks[I+K*nblocks];
       for (j=kl, J=K+1; j<n; j+=bs, J++) {
         jl = j + bs;
         if (jl > n) {
           jl = n;
         }
-        if (BlockOwner(I, J) == MyNum) {  /* parcel out blocks */
+        if (StepOwner(I, J, K) == MyNum) {  /* parcel out blocks */
 //		if (K == 0) printf("%lx\n", BlockOwner(I, J));
-          B = &(a[k+j*n]);
-          C = &(a[i+j*n]);
-          bmod(A, B, C, il-i, jl-j, kl-k, n, MyNum);
+          B = (panels != NULL) ? panels[nblocks+J] : blocks[K+J*nblocks];
+          C = blocks[I+J*nblocks];
+          AL = A;
+          strA = strB = strP;
+          if (lc->arena != NULL) {
+            AL = LocalPanel(lc, I, K, StepOwner(I, K, K), A, &strA, il-i, kl-k, MyNum);
+            B = LocalPanel(lc, nblocks+J, K, StepOwner(K, J, K), B, &strB, kl-k, jl-j, MyNum);
+          }
+          if (profile != NULL) {
+            ts = Seconds();
+          }
+          bmod(AL, B, C, il-i, jl-j, kl-k, strA, strB, strI, MyNum);
+          if (profile != NULL) {
+            profile->addUpdate(I, J, Seconds()-ts);
+          }
         }
       }
     }
@@ -1129,6 +1813,391 @@ pthread_mutex_unlock(&((Global->start).bar_mutex));}
 }
 
 
+/* the tasks of the run come from the DataflowScheduler instead of the
+   step loop, no barriers. panels are read in place (or through the arena
+   with -c), replicas are not used. time waiting for a task counts as
+   barrier time. */
+void DataflowLu(long n, long bs, long MyNum, struct LocalCopies *lc, long dostats)
+{
+  long i, il, j, jl, k, kl;
+  double *C, *D;
+  long strI;
+  unsigned long t1, t2, t3;
+  BlockTask task;
+
+  strI = block_stride;
+  for (;;) {
+    if ((MyNum == 0) || (dostats)) {
+      {long time{}; (t1) = ::time(0);};
+    }
+    const bool more = dataflow->next(MyNum, task);
+    if ((MyNum == 0) || (dostats)) {
+      {long time{}; (t2) = ::time(0);};
+      lc->t_in_bar += (t2-t1);
+    }
+    if (!more) {
+      break;
+    }
+
+    i = task.I*bs;
+    il = min(i+bs, n);
+    j = task.J*bs;
+    jl = min(j+bs, n);
+    k = task.K*bs;
+    kl = min(k+bs, n);
+    C = blocks[task.I+task.J*nblocks];
+    D = blocks[task.K+task.K*nblocks];
+    switch (task.kind) {
+      case BlockTaskKind::Factor:
+        lu0(C, kl-k, strI, MyNum);
+        break;
+      case BlockTaskKind::SolveColumn:
+        bdiv(C, D, strI, strI, il-i, kl-k, MyNum);
+        break;
+      case BlockTaskKind::SolveRow:
+        bmodd(D, C, kl-k, jl-j, strI, strI, MyNum);
+        break;
+      case BlockTaskKind::Update:
+        UpdateBlock(task.I, task.J, task.K, lc, MyNum);
+        break;
+    }
+
+    if ((MyNum == 0) || (dostats)) {
+      {long time{}; (t3) = ::time(0);};
+      if (task.kind == BlockTaskKind::Factor) {
+        lc->t_in_fac += (t3-t2);
+      } else if (task.kind == BlockTaskKind::Update) {
+        lc->t_in_mod += (t3-t2);
+      } else {
+        lc->t_in_solve += (t3-t2);
+      }
+    }
+    dataflow->complete(task);
+  }
+}
+
+
+/* -xlookahead, see LookaheadProgress. own blocks are kept in the order
+   they become panels in. every pass does the first of: the panel
+   operation of an own block of the next panel, an update of an own block
+   of the next lookahead_depth panels, the earliest needed deferred
+   update. passes without any count as barrier time. */
+void LookaheadLu(long n, long bs, long MyNum, struct LocalCopies *lc, long dostats)
+{
+  long I, J, K, b, idx, first, step, factored, count, end;
+  std::vector<long> own;     /* own blocks, by the step they become panels in */
+  std::vector<long> begin;   /* [s]: first own block of panel s, begin[nblocks] = count */
+  std::vector<long> pending; /* [K]: own updates of step K still to do */
+  unsigned long t1 = 0, t2 = 0;
+
+  for (J=0; J<nblocks; J++) {
+    for (I=0; I<nblocks; I++) {
+      if (BlockOwner(I, J) == MyNum) {
+        own.push_back(I+J*nblocks);
+      }
+    }
+  }
+  std::stable_sort(own.begin(), own.end(), [](long x, long y) {
+    return min(x%nblocks, x/nblocks) < min(y%nblocks, y/nblocks);
+  });
+  count = own.size();
+  begin.assign(nblocks+1, count);
+  pending.assign(nblocks, 0);
+  for (idx=count-1; idx>=0; idx--) {
+    b = own[idx];
+    begin[min(b%nblocks, b/nblocks)] = idx;
+    for (K=0; K<min(b%nblocks, b/nblocks); K++) {
+      pending[K]++;
+    }
+  }
+  for (K=nblocks-1; K>=0; K--) {
+    begin[K] = min(begin[K], begin[K+1]);
+  }
+
+  first = 0; /* own blocks before first are done */
+  step = 0;  /* own steps before step are done and published */
+  for (;;) {
+    while (step < nblocks && pending[step] == 0) {
+      lookahead->markStepDone(step);
+      step++;
+    }
+    while (first < count && lookahead->getBlockStep(own[first]) > min(own[first]%nblocks, own[first]/nblocks)) {
+      first++;
+    }
+    if (first == count) {
+      break;
+    }
+    factored = lookahead->getFactoredPanels();
+
+    /* the next panel */
+    b = -1;
+    if (lookahead->mayFactor(factored, P)) {
+      for (idx=begin[factored]; idx<begin[factored+1]; idx++) {
+        I = own[idx]%nblocks;
+        J = own[idx]/nblocks;
+        if (lookahead->getBlockStep(own[idx]) == factored && (I == J || lookahead->getFactoredDiagonals() > factored)) {
+          b = own[idx];
+          break;
+        }
+      }
+    }
+    if (b >= 0) {
+      LookaheadPanel(b, lc, MyNum, dostats);
+      continue;
+    }
+
+    /* updates of the next lookahead_depth panels, then the deferred ones */
+    end = begin[min(factored+lookahead_depth, nblocks)];
+    for (idx=begin[factored]; idx<end && b < 0; idx++) {
+      if (lookahead->getBlockStep(own[idx]) < factored) {
+        b = own[idx];
+      }
+    }
+    for (idx=first; idx<count && b < 0; idx++) {
+      K = lookahead->getBlockStep(own[idx]);
+      if (K < min(own[idx]%nblocks, own[idx]/nblocks) && K < factored) {
+        b = own[idx];
+      }
+    }
+    if (b >= 0) {
+      pending[lookahead->getBlockStep(b)]--;
+      LookaheadUpdate(b, lc, MyNum, dostats);
+      continue;
+    }
+
+    if ((MyNum == 0) || (dostats)) {
+      {long time{}; (t1) = ::time(0);};
+    }
+    sched_yield();
+    if ((MyNum == 0) || (dostats)) {
+      {long time{}; (t2) = ::time(0);};
+      lc->t_in_bar += (t2-t1);
+    }
+  }
+}
+
+
+/* the next update of own block b. */
+void LookaheadUpdate(long b, struct LocalCopies *lc, long MyNum, long dostats)
+{
+  unsigned long t1 = 0, t2 = 0;
+
+  if ((MyNum == 0) || (dostats)) {
+    {long time{}; (t1) = ::time(0);};
+  }
+  UpdateBlock(b%nblocks, b/nblocks, lookahead->getBlockStep(b), lc, MyNum);
+  lookahead->getBlockStep(b)++;
+  if ((MyNum == 0) || (dostats)) {
+    {long time{}; (t2) = ::time(0);};
+    lc->t_in_mod += (t2-t1);
+  }
+}
+
+
+/* the panel operation of own block b once all its updates are done: lu0
+   of a diagonal block, bdiv or bmodd of a perimeter block. */
+void LookaheadPanel(long b, struct LocalCopies *lc, long MyNum, long dostats)
+{
+  long i, il, j, jl, k, kl, I, J, K;
+  double *D;
+  unsigned long t1 = 0, t2 = 0;
+
+  I = b%nblocks;
+  J = b/nblocks;
+  K = min(I, J);
+  i = I*block_size;
+  il = min(i+block_size, n);
+  j = J*block_size;
+  jl = min(j+block_size, n);
+  k = K*block_size;
+  kl = min(k+block_size, n);
+  D = blocks[K+K*nblocks];
+  if ((MyNum == 0) || (dostats)) {
+    {long time{}; (t1) = ::time(0);};
+  }
+  if (I == J) {
+    lu0(D, kl-k, block_stride, MyNum);
+  } else if (I > J) {
+    bdiv(blocks[b], D, block_stride, block_stride, il-i, kl-k, MyNum);
+  } else {
+    bmodd(D, blocks[b], kl-k, jl-j, block_stride, block_stride, MyNum);
+  }
+  lookahead->getBlockStep(b)++;
+  if (I == J) {
+    lookahead->markDiagonalFactored(K);
+  } else {
+    lookahead->markPerimeterSolved(K);
+  }
+  if ((MyNum == 0) || (dostats)) {
+    {long time{}; (t2) = ::time(0);};
+    if (I == J) {
+      lc->t_in_fac += (t2-t1);
+    } else {
+      lc->t_in_solve += (t2-t1);
+    }
+  }
+}
+
+
+void UpdateBlock(long I, long J, long K, struct LocalCopies *lc, long MyNum)
+{
+  long i, il, j, jl, k, kl, strA, strB;
+  double *A, *B;
+
+  i = I*block_size;
+  il = min(i+block_size, n);
+  j = J*block_size;
+  jl = min(j+block_size, n);
+  k = K*block_size;
+  kl = min(k+block_size, n);
+  A = blocks[I+K*nblocks];
+  B = blocks[K+J*nblocks];
+  strA = strB = block_stride;
+  if (lc->arena != NULL) {
+    A = LocalPanel(lc, I, K, BlockOwner(I, K), A, &strA, il-i, kl-k, MyNum);
+    B = LocalPanel(lc, nblocks+J, K, BlockOwner(K, J), B, &strB, kl-k, jl-j, MyNum);
+  }
+  bmod(A, B, blocks[I+J*nblocks], il-i, jl-j, kl-k, strA, strB, block_stride, MyNum);
+}
+
+
+std::vector<long> BlockOwnerTable(void)
+{
+  long I, J;
+  std::vector<long> owners(nblocks*nblocks);
+
+  for (J=0; J<nblocks; J++) {
+    for (I=0; I<nblocks; I++) {
+      owners[I+J*nblocks] = BlockOwner(I, J);
+    }
+  }
+  return(owners);
+}
+
+
+void LayoutBlocks(void)
+{
+  long b;
+  const std::vector<long> offsets = getBlockOffsets(layout, n, block_size);
+
+  for (b=0; b<nblocks*nblocks; b++) {
+    blocks[b] = &(a[offsets[b]]);
+  }
+  block_stride = (layout == Layout::Column) ? n : block_size;
+}
+
+
+/* copies the current block storage into a plain column major n x n array,
+   for checking the result outside of the factorization. */
+void ToColumnMajor(double *dst)
+{
+  long i, j;
+
+  for (j=0; j<n; j++) {
+    for (i=0; i<n; i++) {
+      dst[i+j*n] = *Elem(i, j);
+    }
+  }
+}
+
+
+/* every block gets a chunk of its own, with stride block_size, homed near
+   the core that runs the block's owner. */
+void SliceColoredBlocks(SliceAllocator *allocator, int *cores)
+{
+  long I, J;
+
+  for (J=0; J<nblocks; J++) {
+    for (I=0; I<nblocks; I++) {
+      blocks[I+J*nblocks] = (double *) allocator->allocate(cores[BlockOwner(I, J)]);
+      if (blocks[I+J*nblocks] == NULL) {
+        printerr("Slice allocator ran out of chunks.\n");
+        exit(-1);
+      }
+    }
+  }
+  block_stride = block_size;
+}
+
+
+/* blocks of other owners are copied into this thread's arena on first use
+   in step K and reused by every block of the step that needs them, the
+   stride is updated to the arena's. own blocks are used in place. */
+double *LocalPanel(struct LocalCopies *lc, long slot, long K, long owner, double *src, long *stride, long dimi, long dimj, long MyNum)
+{
+  long i, j;
+  double *dst;
+
+  if (owner == MyNum) {
+    return(src);
+  }
+  dst = &(lc->arena[slot*block_size*block_size]);
+  if (lc->arena_step[slot] != K) {
+    for (j=0; j<dimj; j++) {
+      for (i=0; i<dimi; i++) {
+        dst[i+j*block_size] = src[i+j*(*stride)];
+        if (trace != NULL) {
+          trace->record(MyNum, &src[i+j*(*stride)], false);
+        }
+      }
+    }
+    lc->arena_step[slot] = K;
+  }
+  *stride = block_size;
+  return(dst);
+}
+
+
+void AllocateReplicas(SliceAllocator *allocator, const ReplicaPlan &plan)
+{
+  long r, b, t;
+
+  replica_blocks = (double **) malloc(replica_count*2*nblocks*sizeof(double *));
+  thread_replica = (long *) malloc(P*sizeof(long));
+  if (replica_blocks == NULL || thread_replica == NULL) {
+    printerr("Could not malloc memory for the panel replicas.\n");
+    exit(-1);
+  }
+  for (r=0; r<replica_count; r++) {
+    for (b=0; b<2*nblocks; b++) {
+      replica_blocks[r*2*nblocks+b] = (double *) allocator->allocate(plan.anchor_cores[r]);
+      if (replica_blocks[r*2*nblocks+b] == NULL) {
+        printerr("Slice allocator ran out of chunks.\n");
+        exit(-1);
+      }
+    }
+  }
+  for (t=0; t<P; t++) {
+    thread_replica[t] = plan.thread_replica[t];
+  }
+}
+
+
+/* the owner of a panel block copies it into every replica right after the
+   perimeter phase computed it, the barrier before the interior phase
+   publishes the copies. */
+void CopyToReplicas(double *src, long stride, long dimi, long dimj, long slot)
+{
+  long r, i, j;
+  double *dst;
+
+  for (r=0; r<replica_count; r++) {
+    dst = replica_blocks[r*2*nblocks+slot];
+    for (j=0; j<dimj; j++) {
+      for (i=0; i<dimi; i++) {
+        dst[i+j*block_size] = src[i+j*stride];
+      }
+    }
+  }
+}
+
+
+double *Elem(long i, long j)
+{
+  return(&(blocks[i/block_size+(j/block_size)*nblocks][i%block_size+(j%block_size)*block_stride]));
+}
+
+
 void InitA(double *rhs)
 {
   long i, j;
@@ -1136,9 +2205,9 @@ void InitA(double *rhs)
   srand48((long) 1);
   for (j=0; j<n; j++) {
     for (i=0; i<n; i++) {
-      a[i+j*n] = (double) lrand48()/MAXRAND;
+      *Elem(i, j) = (double) lrand48()/MAXRAND;
       if (i == j) {
-	a[i+j*n] *= 10;
+	*Elem(i, j) *= 10;
       }
     }
   }
@@ -1148,7 +2217,7 @@ void InitA(double *rhs)
   }
   for (j=0; j<n; j++) {
     for (i=0; i<n; i++) {
-      rhs[i] += a[i+j*n];
+      rhs[i] += *Elem(i, j);
     }
   }
 }
@@ -1157,14 +2226,16 @@ void InitA(double *rhs)
 double TouchA(long bs, long MyNum)
 {
   long i, j, I, J;
+  double *A;
   double tot = 0.0;
 
   for (J=0; J*bs<n; J++) {
     for (I=0; I*bs<n; I++) {
       if (BlockOwner(I, J) == MyNum) {
-        for (j=J*bs; j<(J+1)*bs && j<n; j++) {
-          for (i=I*bs; i<(I+1)*bs && i<n; i++) {
-            tot += a[i+j*n];
+        A = blocks[I+J*nblocks];
+        for (j=0; j<bs && J*bs+j<n; j++) {
+          for (i=0; i<bs && I*bs+i<n; i++) {
+            tot += A[i+j*block_stride];
           }
         }
       }
@@ -1180,7 +2251,7 @@ void PrintA()
 
   for (i=0; i<n; i++) {
     for (j=0; j<n; j++) {
-      printf("%8.1f ", a[i+j*n]);
+      printf("%8.1f ", *Elem(i, j));
     }
     printf("\n");
   }
@@ -0,0 +1,91 @@
+#include "matgen.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+static constexpr std::uint32_t PHILOX_M0 = 0xD2511F53;
+static constexpr std::uint32_t PHILOX_M1 = 0xCD9E8D57;
+static constexpr std::uint32_t PHILOX_W0 = 0x9E3779B9;
+static constexpr std::uint32_t PHILOX_W1 = 0xBB67AE85;
+static constexpr auto PHILOX_ROUNDS = 10;
+
+static constexpr double LRAND48_RANGE = 2147483648.0;  // lrand48 is uniform on [0, 2^31).
+static constexpr double MAXRAND = 32767.0;             // InitA's divisor.
+static constexpr double BLOCK_DENSITY = 0.25;          // off diagonal blocks kept by BlockSparse.
+
+// streams keep the draws of different purposes independent.
+static constexpr std::uint32_t ELEMENT_STREAM = 0;
+static constexpr std::uint32_t BLOCK_STREAM = 1;
+
+bool parseMatrixClass(const std::string& name, MatrixClass& matrix_class) {
+    if (name == "random") {
+        matrix_class = MatrixClass::Random;
+    } else if (name == "dominant") {
+        matrix_class = MatrixClass::Dominant;
+    } else if (name == "banded") {
+        matrix_class = MatrixClass::Banded;
+    } else if (name == "blocksparse") {
+        matrix_class = MatrixClass::BlockSparse;
+    } else if (name == "spd") {
+        matrix_class = MatrixClass::Spd;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+MatrixGenerator::MatrixGenerator(MatrixClass matrix_class, long n, long block_size, std::uint64_t seed)
+    : matrix_class_(matrix_class), n_(n), block_size_(block_size), bandwidth_(2 * block_size) {
+    key_[0] = static_cast<std::uint32_t>(seed);
+    key_[1] = static_cast<std::uint32_t>(seed >> 32);
+}
+
+double MatrixGenerator::uniform(std::uint32_t x, std::uint32_t y, std::uint32_t stream) const {
+    std::uint32_t counter[4] = {x, y, stream, 0};
+    std::uint32_t key[2] = {key_[0], key_[1]};
+
+    for (int round = 0; round < PHILOX_ROUNDS; ++round) {
+        const std::uint64_t product0 = static_cast<std::uint64_t>(PHILOX_M0) * counter[0];
+        const std::uint64_t product1 = static_cast<std::uint64_t>(PHILOX_M1) * counter[2];
+        const std::uint32_t next[4] = {
+            static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ key[0], static_cast<std::uint32_t>(product1),
+            static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ key[1], static_cast<std::uint32_t>(product0)};
+        std::copy(next, next + 4, counter);
+        key[0] += PHILOX_W0;
+        key[1] += PHILOX_W1;
+    }
+
+    // 53 random bits.
+    return ((counter[0] >> 5) * 67108864.0 + (counter[1] >> 6)) / 9007199254740992.0;
+}
+
+double MatrixGenerator::get(long i, long j) const {
+    switch (matrix_class_) {
+        case MatrixClass::Random: {
+            const double value = static_cast<long>(uniform(i, j, ELEMENT_STREAM) * LRAND48_RANGE) / MAXRAND;
+            return i == j ? value * 10 : value;
+        }
+        case MatrixClass::Dominant:
+            return i == j ? n_ : 2 * uniform(i, j, ELEMENT_STREAM) - 1;
+        case MatrixClass::Banded:
+            if (i == j) {
+                return 2 * bandwidth_ + 1;
+            }
+            return std::labs(i - j) > bandwidth_ ? 0.0 : 2 * uniform(i, j, ELEMENT_STREAM) - 1;
+        case MatrixClass::BlockSparse: {
+            if (i == j) {
+                return n_;
+            }
+            const long I = i / block_size_;
+            const long J = j / block_size_;
+            if (I != J && uniform(I, J, BLOCK_STREAM) >= BLOCK_DENSITY) {
+                return 0.0;
+            }
+            return 2 * uniform(i, j, ELEMENT_STREAM) - 1;
+        }
+        case MatrixClass::Spd:
+            // symmetric, positive diagonal and strictly diagonally dominant.
+            return i == j ? n_ : uniform(std::min(i, j), std::max(i, j), ELEMENT_STREAM);
+    }
+    return 0.0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// every class is diagonally dominant enough for lu without pivoting, Random follows the value range of InitA's
+// lrand48 stream.
+enum class MatrixClass { Random, Dominant, Banded, BlockSparse, Spd };
+
+// "random", "dominant", "banded", "blocksparse" or "spd".
+bool parseMatrixClass(const std::string& name, MatrixClass& matrix_class);
+
+// counter based (philox 4x32-10) matrix generator: every element is a pure function of (seed, i, j), so any thread
+// can generate any part of the matrix and the result does not depend on how the work was split.
+class MatrixGenerator {
+   public:
+    MatrixGenerator(MatrixClass matrix_class, long n, long block_size, std::uint64_t seed = 1);
+    double get(long i, long j) const;
+
+   private:
+    double uniform(std::uint32_t x, std::uint32_t y, std::uint32_t stream) const;  // [0, 1)
+
+    MatrixClass matrix_class_;
+    long n_;
+    long block_size_;
+    long bandwidth_;
+    std::uint32_t key_[2];
+};
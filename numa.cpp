@@ -0,0 +1,151 @@
+#include "numa.hpp"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+// from linux/mempolicy.h, called through syscall() so that libnuma is not needed.
+static constexpr int MPOL_DEFAULT = 0;
+static constexpr int MPOL_BIND = 2;
+static constexpr int MPOL_INTERLEAVE = 3;
+static constexpr int MPOL_LOCAL = 4;
+
+static constexpr std::uintptr_t PAGE_SIZE = 4096;
+static constexpr auto MAX_NODES = 64;
+static constexpr auto QUERY_BATCH = 4096;  // pages per move_pages call.
+
+bool parseNumaPolicy(const std::string& name, NumaPolicy& policy) {
+    if (name == "local") {
+        policy = NumaPolicy::Local;
+    } else if (name == "interleave") {
+        policy = NumaPolicy::Interleave;
+    } else if (name == "owner") {
+        policy = NumaPolicy::Owner;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int getNodeCount() {
+    // e.g. "0-1" or "0".
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string nodes;
+    if (!(online >> nodes)) {
+        return 1;
+    }
+    const auto last = nodes.find_last_of("-,");
+    return std::min(MAX_NODES, std::stoi(last == std::string::npos ? nodes : nodes.substr(last + 1)) + 1);
+}
+
+int getCoreNode(int core) {
+    for (int node = 0; node < getNodeCount(); ++node) {
+        const auto path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpu" + std::to_string(core);
+        if (access(path.c_str(), F_OK) == 0) {
+            return node;
+        }
+    }
+    return 0;
+}
+
+static bool setPolicy(void* address, std::size_t size, int mode, const unsigned long* mask) {
+    const auto first = reinterpret_cast<std::uintptr_t>(address) & ~(PAGE_SIZE - 1);
+    const auto last = (reinterpret_cast<std::uintptr_t>(address) + size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    return syscall(SYS_mbind, first, last - first, mode, mask, mask == nullptr ? 0 : MAX_NODES + 1, 0) == 0;
+}
+
+bool localPages(void* address, std::size_t size) {
+    return setPolicy(address, size, MPOL_LOCAL, nullptr) || setPolicy(address, size, MPOL_DEFAULT, nullptr);
+}
+
+bool interleavePages(void* address, std::size_t size) {
+    unsigned long mask = 0;
+    for (int node = 0; node < getNodeCount(); ++node) {
+        mask |= 1ul << node;
+    }
+    return setPolicy(address, size, MPOL_INTERLEAVE, &mask);
+}
+
+bool bindPages(void* address, std::size_t size, int node) {
+    const unsigned long mask = 1ul << node;
+    return setPolicy(address, size, MPOL_BIND, &mask);
+}
+
+PageNodeVotes::PageNodeVotes(void* address, std::size_t size)
+    : first_page_(reinterpret_cast<char*>(reinterpret_cast<std::uintptr_t>(address) & ~(PAGE_SIZE - 1))),
+      node_count_(getNodeCount()) {
+    page_count_ = (static_cast<char*>(address) + size - first_page_ + PAGE_SIZE - 1) / PAGE_SIZE;
+    votes_.assign(page_count_ * node_count_, 0);
+}
+
+void PageNodeVotes::add(const void* first, std::size_t bytes, int node) {
+    auto offset = static_cast<std::size_t>(static_cast<const char*>(first) - first_page_);
+    const auto end = offset + bytes;
+    while (offset < end) {
+        const auto page = offset / PAGE_SIZE;
+        const auto page_end = std::min(end, (page + 1) * PAGE_SIZE);
+        votes_[page * node_count_ + node] += page_end - offset;
+        offset = page_end;
+    }
+}
+
+void PageNodeVotes::bind() const {
+    // consecutive pages with the same winner are bound with one call.
+    std::size_t run_start = 0;
+    int run_node = -1;
+    long failures = 0;
+    for (std::size_t page = 0; page <= page_count_; ++page) {
+        int node = -1;
+        if (page < page_count_) {
+            const auto first = votes_.begin() + page * node_count_;
+            node = std::max_element(first, first + node_count_) - first;
+        }
+        if (node != run_node) {
+            if (run_node != -1 && !bindPages(first_page_ + run_start * PAGE_SIZE, (page - run_start) * PAGE_SIZE,
+                                             run_node)) {
+                ++failures;
+            }
+            run_start = page;
+            run_node = node;
+        }
+    }
+    if (failures > 0) {
+        std::cout << failures << " page ranges could not be bound to their owner's node." << std::endl;
+    }
+}
+
+void printNodeReport(const char* name, const void* address, std::size_t size) {
+    const auto first = reinterpret_cast<std::uintptr_t>(address) & ~(PAGE_SIZE - 1);
+    const auto last = reinterpret_cast<std::uintptr_t>(address) + size;
+
+    std::map<int, long> pages_per_node;  // negative: not present or error.
+    for (auto page = first; page < last; page += QUERY_BATCH * PAGE_SIZE) {
+        std::vector<void*> pages;
+        for (auto p = page; p < last && pages.size() < QUERY_BATCH; p += PAGE_SIZE) {
+            pages.push_back(reinterpret_cast<void*>(p));
+        }
+        std::vector<int> status(pages.size(), -1);
+        if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0) != 0) {
+            std::cout << name << ": pages per node are not available." << std::endl;
+            return;
+        }
+        for (const auto node : status) {
+            ++pages_per_node[node < 0 ? -1 : node];
+        }
+    }
+
+    std::cout << name << ": pages per node:";
+    for (const auto& [node, count] : pages_per_node) {
+        if (node < 0) {
+            std::cout << " unknown " << count;
+        } else {
+            std::cout << " node" << node << ' ' << count;
+        }
+    }
+    std::cout << std::endl;
+}
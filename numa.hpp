@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// None leaves placement to whoever touches a page first (the main thread, in InitA). the others first touch a in
+// parallel, every thread its own blocks: Local keeps the kernel's local allocation, Interleave spreads the pages round
+// robin over all nodes, Owner binds every page to the node of the thread owning most of it.
+enum class NumaPolicy { None, Local, Interleave, Owner };
+
+// "local", "interleave" or "owner".
+bool parseNumaPolicy(const std::string& name, NumaPolicy& policy);
+
+int getNodeCount();
+int getCoreNode(int core);
+
+// mbind wrappers, the range is widened to whole pages. false if the kernel refused.
+bool localPages(void* address, std::size_t size);
+bool interleavePages(void* address, std::size_t size);
+bool bindPages(void* address, std::size_t size, int node);
+
+// binds every page of a range to the node that got the most bytes of it.
+class PageNodeVotes {
+   public:
+    PageNodeVotes(void* address, std::size_t size);
+    void add(const void* first, std::size_t bytes, int node);
+    void bind() const;
+
+   private:
+    char* first_page_;
+    std::size_t page_count_;
+    int node_count_;
+    std::vector<long> votes_;  // [page * node_count_ + node], bytes.
+};
+
+// how many pages of the range sit on every node, read with move_pages.
+void printNodeReport(const char* name, const void* address, std::size_t size);
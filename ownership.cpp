@@ -0,0 +1,444 @@
+#include "ownership.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+#include "cha.hpp"
+#include "partition.hpp"
+
+static constexpr std::uintptr_t CACHE_LINE_SIZE = 64;
+static constexpr std::uintptr_t PAGE_SIZE = 4096;
+// shell bands balanced separately by the graph ownership.
+static constexpr long GRAPH_SHELL_BANDS = 4;
+
+bool parseOwnershipStrategy(const std::string &name, OwnershipStrategy &strategy, std::string &table_file) {
+    static const std::string TABLE_PREFIX = "table:";
+    if (name == "cyclic") {
+        strategy = OwnershipStrategy::Cyclic;
+    } else if (name == "2d") {
+        strategy = OwnershipStrategy::Grid;
+    } else if (name == "column") {
+        strategy = OwnershipStrategy::Column;
+    } else if (name == "row") {
+        strategy = OwnershipStrategy::Row;
+    } else if (name == "cha") {
+        strategy = OwnershipStrategy::Cha;
+    } else if (name == "profile") {
+        strategy = OwnershipStrategy::Profile;
+    } else if (name == "graph") {
+        strategy = OwnershipStrategy::Graph;
+    } else if (name.compare(0, TABLE_PREFIX.size(), TABLE_PREFIX) == 0 && name.size() > TABLE_PREFIX.size()) {
+        strategy = OwnershipStrategy::Table;
+        table_file = name.substr(TABLE_PREFIX.size());
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *getOwnershipStrategyName(OwnershipStrategy strategy) {
+    switch (strategy) {
+        case OwnershipStrategy::Cyclic:
+            return "cyclic";
+        case OwnershipStrategy::Grid:
+            return "2d";
+        case OwnershipStrategy::Column:
+            return "column";
+        case OwnershipStrategy::Row:
+            return "row";
+        case OwnershipStrategy::Table:
+            return "table";
+        case OwnershipStrategy::Cha:
+            return "cha";
+        case OwnershipStrategy::Profile:
+            return "profile";
+        case OwnershipStrategy::Graph:
+            return "graph";
+    }
+    return "unknown";
+}
+
+std::vector<long> buildOwnerTable(OwnershipStrategy strategy, long nblocks, long thread_count, long grid_rows,
+                                  long grid_cols) {
+    assert(grid_rows * grid_cols == thread_count);
+    std::vector<long> owners(nblocks * nblocks);
+    for (long J = 0; J < nblocks; ++J) {
+        for (long I = 0; I < nblocks; ++I) {
+            long owner;
+            switch (strategy) {
+                case OwnershipStrategy::Grid:
+                    owner = (I % grid_rows) + (J % grid_cols) * grid_rows;  // block rows over the grid rows.
+                    break;
+                case OwnershipStrategy::Column:
+                    owner = J % thread_count;
+                    break;
+                case OwnershipStrategy::Row:
+                    owner = I % thread_count;
+                    break;
+                default:
+                    owner = (I + J * nblocks) % thread_count;
+                    break;
+            }
+            owners[I + J * nblocks] = owner;
+        }
+    }
+    return owners;
+}
+
+bool loadOwnerTable(const std::string &filename, long nblocks, long thread_count, std::vector<long> &owners) {
+    std::ifstream infile(filename);
+    if (!infile) {
+        std::cerr << "could not open owner table " << filename << '\n';
+        return false;
+    }
+
+    std::vector<std::vector<long>> pattern;  // [I][J]
+    std::string line;
+    while (std::getline(infile, line)) {
+        std::istringstream iss(line);
+        std::vector<long> row;
+        long owner;
+        while (iss >> owner) {
+            if (owner < 0 || owner >= thread_count) {
+                std::cerr << "owner table " << filename << " names thread " << owner << '\n';
+                return false;
+            }
+            row.push_back(owner);
+        }
+        if (!row.empty()) {
+            pattern.push_back(row);
+        }
+    }
+    if (pattern.empty()) {
+        std::cerr << "owner table " << filename << " is empty\n";
+        return false;
+    }
+    for (const auto &row : pattern) {
+        if (row.size() != pattern.front().size()) {
+            std::cerr << "owner table " << filename << " has rows of different lengths\n";
+            return false;
+        }
+    }
+
+    owners.assign(nblocks * nblocks, 0);
+    for (long J = 0; J < nblocks; ++J) {
+        for (long I = 0; I < nblocks; ++I) {
+            const auto &row = pattern[I % pattern.size()];
+            owners[I + J * nblocks] = row[J % row.size()];
+        }
+    }
+    return true;
+}
+
+std::vector<std::map<int, int>> getBlockChaHistograms(const double *const *blocks, long stride, long n,
+                                                      long block_size, long first_shell) {
+    const long nblocks = (n + block_size - 1) / block_size;
+    std::vector<std::map<int, int>> histograms(nblocks * nblocks);
+
+    // pagemap is read once per page, the hash is evaluated per line.
+    std::uintptr_t cached_page = 0;
+    std::uintptr_t cached_physical_page = 0;
+
+    for (long J = first_shell; J < nblocks; ++J) {
+        for (long I = first_shell; I < nblocks; ++I) {
+            auto &histogram = histograms[I + J * nblocks];
+            const long rows = std::min(n - I * block_size, block_size);
+
+            for (long j = 0; j < block_size && J * block_size + j < n; ++j) {
+                const auto first = reinterpret_cast<std::uintptr_t>(&blocks[I + J * nblocks][j * stride]);
+                const auto last = reinterpret_cast<std::uintptr_t>(&blocks[I + J * nblocks][rows - 1 + j * stride]);
+
+                for (auto line = first & ~(CACHE_LINE_SIZE - 1); line <= last; line += CACHE_LINE_SIZE) {
+                    const auto page = line & ~(PAGE_SIZE - 1);
+                    if (page != cached_page) {
+                        cached_page = page;
+                        cached_physical_page = getPhysicalAddress(page);
+                    }
+                    ++histogram[findCHAByPhysicalAddress(cached_physical_page + (line - page))];
+                }
+            }
+        }
+    }
+
+    return histograms;
+}
+
+static long getBlockCost(const std::map<int, int> &histogram, const std::vector<int> &core_cha_cost) {
+    long cost = 0;
+    for (const auto &[cha, count] : histogram) {
+        if (cha >= 0 && cha < core_cha_cost.size()) {
+            cost += count * core_cha_cost[cha];
+        }
+    }
+    return cost;
+}
+
+std::vector<long> buildChaAwareOwnership(const double *const *blocks, long stride, long n, long block_size,
+                                         const std::vector<int> &thread_to_core, Topology &topo) {
+    const long P = thread_to_core.size();
+    const long nblocks = (n + block_size - 1) / block_size;
+    const auto histograms = getBlockChaHistograms(blocks, stride, n, block_size);
+
+    int cha_count = 0;
+    while (topo.getTile(cha_count).cha != UNDEFINED) {
+        ++cha_count;
+    }
+
+    std::vector<std::vector<int>> core_cha_cost(P, std::vector<int>(cha_count));
+    for (long t = 0; t < P; ++t) {
+        for (int cha = 0; cha < cha_count; ++cha) {
+            core_cha_cost[t][cha] = topo.getHopCost(thread_to_core[t], cha);
+        }
+    }
+
+    std::vector<long> owners(nblocks * nblocks, 0);
+    long total_cost = 0;
+    long round_robin_cost = 0;
+    std::vector<long> total_load(P, 0);
+
+    for (long shell = 0; shell < nblocks; ++shell) {
+        std::vector<long> blocks;  // I + J * nblocks
+        for (long J = shell; J < nblocks; ++J) {
+            blocks.push_back(shell + J * nblocks);
+        }
+        for (long I = shell + 1; I < nblocks; ++I) {
+            blocks.push_back(I + shell * nblocks);
+        }
+
+        // cost of every block on every thread, and how much the block loses if it misses its best thread.
+        std::vector<std::vector<long>> costs(blocks.size(), std::vector<long>(P));
+        std::vector<std::pair<long, long>> regrets;  // (regret, index into blocks)
+        for (long b = 0; b < blocks.size(); ++b) {
+            for (long t = 0; t < P; ++t) {
+                costs[b][t] = getBlockCost(histograms[blocks[b]], core_cha_cost[t]);
+            }
+            auto sorted = costs[b];
+            std::sort(sorted.begin(), sorted.end());
+            regrets.emplace_back(P > 1 ? sorted[1] - sorted[0] : 0, b);
+
+            round_robin_cost += costs[b][blocks[b] % P];  // what BlockOwner's (I + J*nblocks) % P would pay.
+        }
+        std::sort(regrets.begin(), regrets.end(), std::greater<>());
+
+        // every thread gets floor(blocks / P) blocks of the shell, the remainder goes to the threads that own the
+        // fewest blocks so far.
+        std::vector<long> capacity(P, blocks.size() / P);
+        std::vector<long> by_total_load(P);
+        for (long t = 0; t < P; ++t) {
+            by_total_load[t] = t;
+        }
+        std::stable_sort(by_total_load.begin(), by_total_load.end(),
+                         [&total_load](long lhs, long rhs) { return total_load[lhs] < total_load[rhs]; });
+        for (long r = 0; r < blocks.size() % P; ++r) {
+            ++capacity[by_total_load[r]];
+        }
+
+        for (const auto &[regret, b] : regrets) {
+            long best_thread = -1;
+            for (long t = 0; t < P; ++t) {
+                if (capacity[t] > 0 && (best_thread == -1 || costs[b][t] < costs[b][best_thread])) {
+                    best_thread = t;
+                }
+            }
+            assert(best_thread != -1);
+
+            --capacity[best_thread];
+            ++total_load[best_thread];
+            owners[blocks[b]] = best_thread;
+            total_cost += costs[b][best_thread];
+        }
+    }
+
+    std::cout << "cha aware ownership built. line weighted hop cost: " << total_cost
+              << " (round robin: " << round_robin_cost << ")" << std::endl;
+
+    return owners;
+}
+
+TaskProfile::TaskProfile(long nblocks)
+    : nblocks_(nblocks), update_(nblocks * nblocks, -1.0), last_(nblocks * nblocks, 0.0) {}
+
+void TaskProfile::addUpdate(long I, long J, double seconds) {
+    auto &update = update_[I + J * nblocks_];
+    if (update < 0.0 || seconds < update) {
+        update = seconds;
+    }
+}
+
+void TaskProfile::setLast(long I, long J, double seconds) {
+    last_[I + J * nblocks_] = seconds;
+}
+
+double TaskProfile::getUpdateCost(long I, long J) const {
+    return std::max(0.0, update_[I + J * nblocks_]);
+}
+
+// sum over the steps K of the slowest thread's trailing update, relative to a perfect split.
+static double getUpdateImbalance(const TaskProfile &profile, const std::vector<long> &owners, long thread_count) {
+    const long nblocks = profile.getBlockCount();
+    std::vector<double> load(thread_count, 0.0);
+    double total = 0.0;
+    double slowest = 0.0;
+    double even = 0.0;
+    for (long K = nblocks - 2; K >= 0; --K) {
+        // the blocks of shell K + 1 join the update from step K on down.
+        const long s = K + 1;
+        for (long b = s; b < nblocks; ++b) {
+            load[owners[s + b * nblocks]] += profile.getUpdateCost(s, b);
+            total += profile.getUpdateCost(s, b);
+            if (b != s) {
+                load[owners[b + s * nblocks]] += profile.getUpdateCost(b, s);
+                total += profile.getUpdateCost(b, s);
+            }
+        }
+        slowest += *std::max_element(load.begin(), load.end());
+        even += total / thread_count;
+    }
+    return even > 0.0 ? slowest / even : 1.0;
+}
+
+std::vector<long> buildProfiledOwnership(const TaskProfile &profile, long thread_count) {
+    const long nblocks = profile.getBlockCount();
+    std::vector<long> owners(nblocks * nblocks, 0);
+    std::vector<double> load(thread_count, 0.0);  // update cost of the shells done so far.
+
+    for (long shell = nblocks - 1; shell >= 0; --shell) {
+        std::vector<std::pair<long, long>> blocks;  // (I, J) along the L
+        for (long I = nblocks - 1; I > shell; --I) {
+            blocks.emplace_back(I, shell);
+        }
+        for (long J = shell; J < nblocks; ++J) {
+            blocks.emplace_back(shell, J);
+        }
+
+        std::vector<double> weights;
+        double total = 0.0;
+        for (const auto &[I, J] : blocks) {
+            weights.push_back(shell > 0 ? profile.getUpdateCost(I, J) : profile.getLastCost(I, J));
+            total += weights.back();
+        }
+        if (shell == 0) {
+            std::fill(load.begin(), load.end(), 0.0);  // only the perimeter of step 0, split it on its own.
+        }
+
+        // the shares of the threads, in thread order along the L: whatever brings each up to an even load of the
+        // shells so far, nothing for threads that are above it already.
+        const double target = (std::accumulate(load.begin(), load.end(), 0.0) + total) / thread_count;
+        std::vector<double> share_end(thread_count);
+        double shares = 0.0;
+        for (long t = 0; t < thread_count; ++t) {
+            shares += std::max(0.0, target - load[t]);
+            share_end[t] = shares;
+        }
+
+        // a block goes to the thread whose share holds the middle of its weight.
+        double before = 0.0;
+        for (long b = 0; b < blocks.size(); ++b) {
+            long thread = b * thread_count / blocks.size();
+            if (total > 0.0 && shares > 0.0) {
+                const double middle = (before + weights[b] / 2) / total * shares;
+                thread = std::upper_bound(share_end.begin(), share_end.end(), middle) - share_end.begin();
+                thread = std::min(thread_count - 1, thread);
+            }
+            owners[blocks[b].first + blocks[b].second * nblocks] = thread;
+            load[thread] += weights[b];
+            before += weights[b];
+        }
+    }
+
+    std::vector<long> round_robin(nblocks * nblocks);
+    for (long b = 0; b < nblocks * nblocks; ++b) {
+        round_robin[b] = b % thread_count;
+    }
+    std::cout << "profiled ownership built. slowest thread over an even split of the trailing updates: "
+              << getUpdateImbalance(profile, owners, thread_count)
+              << " (round robin: " << getUpdateImbalance(profile, round_robin, thread_count) << ")" << std::endl;
+
+    return owners;
+}
+
+// panel blocks sent between threads by owners: every panel block counts once for every other thread that reads it.
+static long getPanelSends(const std::vector<int> &owners, long nblocks, long thread_count) {
+    const auto owner = [&](long I, long J) { return owners[I + J * nblocks]; };
+    std::vector<char> seen(thread_count);
+    long sends = 0;
+    for (long L = 0; L < nblocks; ++L) {
+        // the panel blocks (L, M < L) are read by the rest of row L right of them, (M < L, L) by column L below them.
+        for (const bool row : {true, false}) {
+            std::fill(seen.begin(), seen.end(), 0);
+            long readers = 0;
+            for (long M = nblocks - 1; M >= 0; --M) {
+                const int thread = row ? owner(L, M) : owner(M, L);
+                if (M < L) {
+                    sends += readers - seen[thread];
+                }
+                readers += !seen[thread];
+                seen[thread] = 1;
+            }
+        }
+        // the diagonal block by its perimeter.
+        std::fill(seen.begin(), seen.end(), 0);
+        long readers = 0;
+        for (long M = L + 1; M < nblocks; ++M) {
+            for (const int thread : {owner(L, M), owner(M, L)}) {
+                readers += !seen[thread];
+                seen[thread] = 1;
+            }
+        }
+        sends += readers - seen[owner(L, L)];
+    }
+    return sends;
+}
+
+std::vector<long> buildGraphOwnership(long nblocks, long thread_count) {
+    const long bands = std::min(GRAPH_SHELL_BANDS, nblocks);
+    Graph graph;
+    graph.constraint_count = bands;
+    graph.vertex_weights.assign(nblocks * nblocks * bands, 0);
+
+    // the panel blocks (I, K) are read along block row I by the blocks (I, J > K), the panel blocks (K, J) along block
+    // column J by the blocks (I > K, J), and the diagonal blocks by their perimeter. instead of an edge per read, which
+    // are nblocks^3, the reads are summed per link between neighbours of a row or column: the link right of (I, J)
+    // carries the min(I, J) + 1 panel blocks of row I at or left of it that are read beyond it, the link below (I, J)
+    // those of column J. a panel block then costs a link for every change of owner along its readers, which is one per
+    // other thread that reads it if every thread holds a run of the row or column.
+    for (long J = 0; J < nblocks; ++J) {
+        for (long I = 0; I < nblocks; ++I) {
+            const long s = std::min(I, J);
+            const long v = I + J * nblocks;
+            // a bmod is twice the flops of a bdiv or bmodd, lu0 is counted like them.
+            graph.vertex_weights[v * bands + s * bands / nblocks] = 2 * s + 1;
+
+            const std::pair<long, long> neighbours[] = {{I - 1, J}, {I + 1, J}, {I, J - 1}, {I, J + 1}};
+            for (const auto &[NI, NJ] : neighbours) {
+                if (NI >= 0 && NI < nblocks && NJ >= 0 && NJ < nblocks) {
+                    graph.adjacency.push_back(NI + NJ * nblocks);
+                    graph.edge_weights.push_back(std::min(std::min(I, J), std::min(NI, NJ)) + 1);
+                }
+            }
+            graph.offsets.push_back(graph.adjacency.size());
+        }
+    }
+
+    std::vector<int> parts = partitionGraph(graph, thread_count);
+    std::vector<int> round_robin(nblocks * nblocks);
+    for (long b = 0; b < nblocks * nblocks; ++b) {
+        round_robin[b] = b % thread_count;
+    }
+    const long sends = getPanelSends(parts, nblocks, thread_count);
+    const long round_robin_sends = getPanelSends(round_robin, nblocks, thread_count);
+    std::cout << "graph ownership built. link cut: " << getEdgeCut(graph, parts) << ", panel blocks sent across threads: "
+              << sends << " (round robin: " << round_robin_sends << ")" << std::endl;
+    if (round_robin_sends <= sends) {
+        std::cout << "the partition does not send fewer panel blocks, falling back to round robin ownership."
+                  << std::endl;
+        parts = round_robin;
+    }
+
+    return std::vector<long>(parts.begin(), parts.end());
+}
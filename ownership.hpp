@@ -0,0 +1,75 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "topology.hpp"
+
+// how blocks are given to threads. Cyclic deals them round robin in I + J * nblocks order, Grid block-cyclic over a
+// grid_rows x grid_cols processor grid, so that every panel block is read by about sqrt(P) threads instead of P, Column
+// whole block columns and Row whole block rows round robin, Table a pattern from a file and Cha by the chas that home
+// the lines of every block, Profile by the task times of a profiling run and Graph by a partition of the block
+// dependency graph.
+enum class OwnershipStrategy { Cyclic, Grid, Column, Row, Table, Cha, Profile, Graph };
+
+// "cyclic", "2d", "column", "row", "cha", "profile", "graph" or "table:<file>". the file of a table goes to table_file.
+bool parseOwnershipStrategy(const std::string& name, OwnershipStrategy& strategy, std::string& table_file);
+
+const char* getOwnershipStrategyName(OwnershipStrategy strategy);
+
+// owner table (indexed by I + J * nblocks) of Cyclic, Grid, Column or Row. grid_rows * grid_cols is thread_count.
+std::vector<long> buildOwnerTable(OwnershipStrategy strategy, long nblocks, long thread_count, long grid_rows,
+                                  long grid_cols);
+
+// owner table from a file with one line of thread ids per block row. the lines may be shorter than nblocks and there
+// may be fewer than nblocks of them, the pattern is repeated over the blocks then. false if the file is unreadable,
+// ragged or names a thread outside 0 .. thread_count - 1.
+bool loadOwnerTable(const std::string& filename, long nblocks, long thread_count, std::vector<long>& owners);
+
+// how many lines of every block of the n x n matrix each cha homes. blocks[I + J * nblocks] is the first element of
+// block (I, J), stride the distance between two of its columns. indexed by I + J * nblocks. blocks with min(I, J) below
+// first_shell are skipped and left empty.
+std::vector<std::map<int, int>> getBlockChaHistograms(const double* const* blocks, long stride, long n,
+                                                      long block_size, long first_shell = 0);
+
+// block owner table (indexed by I + J * nblocks) that gives every block to the thread whose core is closest to the chas
+// homing the block's lines. blocks are balanced per shell min(I, J): a block of shell s is last updated in step K = s,
+// so balancing every shell keeps the trailing update of every K balanced like the round robin BlockOwner does.
+std::vector<long> buildChaAwareOwnership(const double* const* blocks, long stride, long n, long block_size,
+                                         const std::vector<int>& thread_to_core, Topology& topo);
+
+// wall time of the block tasks of one run: per block its fastest update (bmod), which filters out the preemptions of a
+// busy machine, and its last operation (lu0, bdiv or bmodd). a block is only ever written by its owner, so recording
+// needs no locking.
+class TaskProfile {
+public:
+    explicit TaskProfile(long nblocks);
+
+    void addUpdate(long I, long J, double seconds);
+    void setLast(long I, long J, double seconds);
+
+    long getBlockCount() const { return nblocks_; }
+    double getUpdateCost(long I, long J) const;
+    double getLastCost(long I, long J) const { return last_[I + J * nblocks_]; }
+
+private:
+    long nblocks_;
+    std::vector<double> update_;  // -1 before the first update.
+    std::vector<double> last_;
+};
+
+// owner table (indexed by I + J * nblocks) from a profile. a block of shell s = min(I, J) is updated in every step
+// K < s, so the trailing update of step K is the blocks of the shells after K. shells are split from the last one on,
+// each so that it evens out the load of the shells before it as far as it can. the blocks of a shell are split into
+// runs of neighbours along its L, from the bottom of the column to the end of the row, in thread order, so that every
+// thread keeps a contiguous band. shell 0 has no updates and is split evenly by its last operations.
+std::vector<long> buildProfiledOwnership(const TaskProfile& profile, long thread_count);
+
+// owner table (indexed by I + J * nblocks) from a partition of the graph of the whole factorization: a vertex per block,
+// weighted by the flops of its tasks, and edges between the neighbours of every block row and column, weighted by the
+// panel blocks read across them. the graph has O(nblocks^2) edges. the partition keeps blocks next to the blocks they
+// read, so fewer panel blocks travel between threads. the shells min(I, J) are grouped into a few bands that are
+// balanced one by one, which keeps the trailing update of every K close to balanced. falls back to round robin, and
+// says so, if that sends no more panel blocks.
+std::vector<long> buildGraphOwnership(long nblocks, long thread_count);
@@ -0,0 +1,362 @@
+#include "partition.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <set>
+#include <tuple>
+
+// coarsening stops at this many vertices per part, or once a level keeps more than MIN_COARSENING of its vertices.
+static constexpr auto COARSEST_VERTICES_PER_PART = 15;
+static constexpr auto MIN_COARSENING = 0.95;
+static constexpr auto REFINEMENT_PASSES = 8;
+// partitions tried from different random orders, the one with the smallest cut is kept.
+static constexpr auto TRIALS = 4;
+static constexpr unsigned SEED = 1;
+
+long getEdgeCut(const Graph& graph, const std::vector<int>& parts) {
+    long cut = 0;
+    for (long v = 0; v < graph.getVertexCount(); ++v) {
+        for (long e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+            if (parts[v] != parts[graph.adjacency[e]]) {
+                cut += graph.edge_weights[e];
+            }
+        }
+    }
+    return cut / 2;
+}
+
+static long getTotalWeight(const Graph& graph, long v) {
+    long weight = 0;
+    for (int c = 0; c < graph.constraint_count; ++c) {
+        weight += graph.vertex_weights[v * graph.constraint_count + c];
+    }
+    return weight;
+}
+
+// the most a part may weigh in every constraint.
+static std::vector<long> getPartLimits(const Graph& graph, int part_count, double imbalance) {
+    const int C = graph.constraint_count;
+    std::vector<long> totals(C, 0);
+    std::vector<long> heaviest(C, 0);
+    for (long v = 0; v < graph.getVertexCount(); ++v) {
+        for (int c = 0; c < C; ++c) {
+            totals[c] += graph.vertex_weights[v * C + c];
+            heaviest[c] = std::max(heaviest[c], graph.vertex_weights[v * C + c]);
+        }
+    }
+    std::vector<long> limits(C);
+    for (int c = 0; c < C; ++c) {
+        const double average = static_cast<double>(totals[c]) / part_count;
+        limits[c] = std::max(static_cast<long>(std::ceil((1.0 + imbalance) * average)),
+                             static_cast<long>(std::ceil(average)) + heaviest[c]);
+    }
+    return limits;
+}
+
+// whether vertex v can join a part of part_weight. constraints v does not weigh in are not checked, a part over the
+// limit in one of them may still take it.
+static bool fits(const Graph& graph, long v, const long* part_weight, const std::vector<long>& limits) {
+    for (int c = 0; c < graph.constraint_count; ++c) {
+        const long weight = graph.vertex_weights[v * graph.constraint_count + c];
+        if (weight > 0 && part_weight[c] + weight > limits[c]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// whether vertex v weighs in a constraint in which part_weight is over the limit.
+static bool isOver(const Graph& graph, long v, const long* part_weight, const std::vector<long>& limits) {
+    for (int c = 0; c < graph.constraint_count; ++c) {
+        if (graph.vertex_weights[v * graph.constraint_count + c] > 0 && part_weight[c] > limits[c]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// the constraint v weighs most in.
+static int getMainConstraint(const Graph& graph, long v) {
+    const auto first = graph.vertex_weights.begin() + v * graph.constraint_count;
+    return std::max_element(first, first + graph.constraint_count) - first;
+}
+
+// matches every vertex with its unmatched neighbour over the heaviest edge, if the pair stays below
+// max_vertex_weight and both weigh most in the same constraint, and merges the pairs. coarse_of maps the vertices of
+// graph to those of the result.
+static Graph coarsen(const Graph& graph, long max_vertex_weight, std::mt19937& rng, std::vector<int>& coarse_of) {
+    const long n = graph.getVertexCount();
+    const int C = graph.constraint_count;
+
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    std::vector<int> match(n, -1);
+    for (const auto v : order) {
+        if (match[v] != -1) {
+            continue;
+        }
+        int best = v;
+        long best_weight = 0;
+        for (long e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+            const int u = graph.adjacency[e];
+            if (match[u] == -1 && u != v && graph.edge_weights[e] > best_weight &&
+                getTotalWeight(graph, v) + getTotalWeight(graph, u) <= max_vertex_weight &&
+                getMainConstraint(graph, u) == getMainConstraint(graph, v)) {
+                best = u;
+                best_weight = graph.edge_weights[e];
+            }
+        }
+        match[v] = best;
+        match[best] = v;
+    }
+
+    coarse_of.assign(n, -1);
+    std::vector<int> representative;  // [coarse vertex]: its first vertex in graph.
+    for (int v = 0; v < n; ++v) {
+        if (coarse_of[v] == -1) {
+            coarse_of[v] = coarse_of[match[v]] = representative.size();
+            representative.push_back(v);
+        }
+    }
+
+    Graph coarse;
+    coarse.constraint_count = C;
+    coarse.vertex_weights.assign(representative.size() * C, 0);
+    std::vector<long> connection(representative.size(), 0);
+    std::vector<int> touched;
+    for (int c = 0; c < static_cast<int>(representative.size()); ++c) {
+        const int first = representative[c];
+        const int last = match[first];  // first itself if unmatched.
+        for (int v = first;; v = last) {
+            for (int k = 0; k < C; ++k) {
+                coarse.vertex_weights[c * C + k] += graph.vertex_weights[v * C + k];
+            }
+            for (long e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+                const int u = coarse_of[graph.adjacency[e]];
+                if (u == c) {
+                    continue;
+                }
+                if (connection[u] == 0) {
+                    touched.push_back(u);
+                }
+                connection[u] += graph.edge_weights[e];
+            }
+            if (v == last) {
+                break;
+            }
+        }
+        for (const auto u : touched) {
+            coarse.adjacency.push_back(u);
+            coarse.edge_weights.push_back(connection[u]);
+            connection[u] = 0;
+        }
+        touched.clear();
+        coarse.offsets.push_back(coarse.adjacency.size());
+    }
+    return coarse;
+}
+
+// grows the parts one after the other, each from the vertex most connected to the parts before it and then by the
+// vertex most connected to it, until it has its share of the total weight. the last part takes the rest.
+static std::vector<int> growParts(const Graph& graph, int part_count, const std::vector<long>& limits) {
+    const long n = graph.getVertexCount();
+    const int C = graph.constraint_count;
+
+    long total = 0;
+    for (long v = 0; v < n; ++v) {
+        total += getTotalWeight(graph, v);
+    }
+
+    std::vector<int> parts(n, -1);
+    std::vector<long> connection(n, 0);  // to the part being grown.
+    std::vector<long> outside(n, 0);     // to the parts grown before.
+    std::set<std::tuple<long, long, int>> candidates;  // (-connection, -outside, vertex) of the unassigned vertices.
+    for (int v = 0; v < n; ++v) {
+        candidates.emplace(0, 0, v);
+    }
+
+    for (int p = 0; p + 1 < part_count; ++p) {
+        std::vector<long> weight(C, 0);
+        long sum = 0;
+        std::vector<int> touched;
+        while (sum < total / part_count) {
+            auto best = candidates.begin();
+            while (best != candidates.end() && !fits(graph, std::get<2>(*best), weight.data(), limits)) {
+                ++best;
+            }
+            if (best == candidates.end()) {
+                break;
+            }
+            const int v = std::get<2>(*best);
+            candidates.erase(best);
+            parts[v] = p;
+            for (int c = 0; c < C; ++c) {
+                weight[c] += graph.vertex_weights[v * C + c];
+            }
+            sum += getTotalWeight(graph, v);
+            for (long e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+                const int u = graph.adjacency[e];
+                if (parts[u] != -1) {
+                    continue;
+                }
+                candidates.erase({-connection[u], -outside[u], u});
+                connection[u] += graph.edge_weights[e];
+                outside[u] += graph.edge_weights[e];
+                candidates.emplace(-connection[u], -outside[u], u);
+                touched.push_back(u);
+            }
+        }
+        for (const auto u : touched) {
+            if (parts[u] == -1 && connection[u] != 0) {
+                candidates.erase({-connection[u], -outside[u], u});
+                connection[u] = 0;
+                candidates.emplace(0, -outside[u], u);
+            }
+        }
+    }
+    for (const auto& candidate : candidates) {
+        parts[std::get<2>(candidate)] = part_count - 1;
+    }
+    return parts;
+}
+
+// moves vertices to the neighbouring part they are most connected to while that cuts less and the part has room.
+// vertices that keep their part above a limit may also move at a loss, to any part with room.
+static void refine(const Graph& graph, int part_count, const std::vector<long>& limits, std::mt19937& rng,
+                   std::vector<int>& parts) {
+    const long n = graph.getVertexCount();
+    const int C = graph.constraint_count;
+
+    std::vector<long> part_weights(part_count * C, 0);
+    for (long v = 0; v < n; ++v) {
+        for (int c = 0; c < C; ++c) {
+            part_weights[parts[v] * C + c] += graph.vertex_weights[v * C + c];
+        }
+    }
+
+    std::vector<int> order;
+    std::vector<long> connection(part_count, 0);
+    std::vector<int> touched;
+    for (int pass = 0; pass < REFINEMENT_PASSES; ++pass) {
+        // only vertices on the boundary of their part, or that may have to leave it, can move.
+        order.clear();
+        for (int v = 0; v < n; ++v) {
+            bool boundary = isOver(graph, v, &part_weights[parts[v] * C], limits);
+            for (long e = graph.offsets[v]; e < graph.offsets[v + 1] && !boundary; ++e) {
+                boundary = parts[graph.adjacency[e]] != parts[v];
+            }
+            if (boundary) {
+                order.push_back(v);
+            }
+        }
+        std::shuffle(order.begin(), order.end(), rng);
+        long moved = 0;
+        for (const auto v : order) {
+            const int from = parts[v];
+            for (long e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+                const int p = parts[graph.adjacency[e]];
+                if (connection[p] == 0) {
+                    touched.push_back(p);
+                }
+                connection[p] += graph.edge_weights[e];
+            }
+
+            // neighbouring parts only, unless the vertex has to leave.
+            const bool over = isOver(graph, v, &part_weights[from * C], limits);
+            int best = from;
+            long best_gain = over ? LONG_MIN : 0;
+            const auto consider = [&](int p) {
+                const long gain = connection[p] - connection[from];
+                if (p != from && gain > best_gain && fits(graph, v, &part_weights[p * C], limits)) {
+                    best = p;
+                    best_gain = gain;
+                }
+            };
+            if (over) {
+                for (int p = 0; p < part_count; ++p) {
+                    consider(p);
+                }
+            } else {
+                for (const auto p : touched) {
+                    consider(p);
+                }
+            }
+            for (const auto p : touched) {
+                connection[p] = 0;
+            }
+            touched.clear();
+
+            if (best != from) {
+                for (int c = 0; c < C; ++c) {
+                    part_weights[from * C + c] -= graph.vertex_weights[v * C + c];
+                    part_weights[best * C + c] += graph.vertex_weights[v * C + c];
+                }
+                parts[v] = best;
+                ++moved;
+            }
+        }
+        if (moved == 0) {
+            break;
+        }
+    }
+}
+
+// one multilevel partition, coarsened and refined in the order rng gives.
+static std::vector<int> partitionOnce(const Graph& graph, int part_count, double imbalance, std::mt19937& rng) {
+    long total = 0;
+    for (long v = 0; v < graph.getVertexCount(); ++v) {
+        total += getTotalWeight(graph, v);
+    }
+    const long coarsest = COARSEST_VERTICES_PER_PART * part_count;
+    const long max_vertex_weight = std::max(1L, 3 * total / (2 * coarsest));
+
+    std::vector<Graph> levels;
+    std::vector<std::vector<int>> coarse_of;
+    const Graph* current = &graph;
+    while (current->getVertexCount() > coarsest) {
+        std::vector<int> map;
+        Graph coarse = coarsen(*current, max_vertex_weight, rng, map);
+        if (coarse.getVertexCount() > MIN_COARSENING * current->getVertexCount()) {
+            break;
+        }
+        levels.push_back(std::move(coarse));
+        coarse_of.push_back(std::move(map));
+        current = &levels.back();
+    }
+
+    std::vector<int> parts = growParts(*current, part_count, getPartLimits(*current, part_count, imbalance));
+    refine(*current, part_count, getPartLimits(*current, part_count, imbalance), rng, parts);
+    for (long level = levels.size() - 1; level >= 0; --level) {
+        const Graph& finer = level > 0 ? levels[level - 1] : graph;
+        std::vector<int> finer_parts(finer.getVertexCount());
+        for (long v = 0; v < finer.getVertexCount(); ++v) {
+            finer_parts[v] = parts[coarse_of[level][v]];
+        }
+        parts = std::move(finer_parts);
+        refine(finer, part_count, getPartLimits(finer, part_count, imbalance), rng, parts);
+    }
+    return parts;
+}
+
+std::vector<int> partitionGraph(const Graph& graph, int part_count, double imbalance) {
+    if (part_count <= 1) {
+        return std::vector<int>(graph.getVertexCount(), 0);
+    }
+    std::mt19937 rng(SEED);
+    std::vector<int> best;
+    long best_cut = LONG_MAX;
+    for (int trial = 0; trial < TRIALS; ++trial) {
+        auto parts = partitionOnce(graph, part_count, imbalance, rng);
+        const long cut = getEdgeCut(graph, parts);
+        if (cut < best_cut) {
+            best = std::move(parts);
+            best_cut = cut;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+// undirected graph with one weight per vertex and constraint. the neighbours of vertex v are adjacency[offsets[v] ..
+// offsets[v + 1]), every edge is listed at both of its ends with the same weight.
+struct Graph {
+    int constraint_count = 1;
+    std::vector<long> vertex_weights;  // [v * constraint_count + c]
+    std::vector<long> offsets{0};
+    std::vector<int> adjacency;
+    std::vector<long> edge_weights;
+
+    long getVertexCount() const { return offsets.size() - 1; }
+};
+
+// splits graph into part_count parts with little edge weight between them. in every constraint no part gets more than
+// (1 + imbalance) times the average, or the average plus the heaviest vertex if that is more. multilevel: the graph is
+// coarsened by heavy edge matching, the coarsest one split by greedy growing, and the split refined by greedy boundary
+// moves on every level on the way back. deterministic.
+std::vector<int> partitionGraph(const Graph& graph, int part_count, double imbalance = 0.03);
+
+// weight of the edges between different parts.
+long getEdgeCut(const Graph& graph, const std::vector<int>& parts);
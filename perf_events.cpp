@@ -0,0 +1,59 @@
+#include "perf_events.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <initializer_list>
+
+static int openTlbEvent(unsigned long long op) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (op << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+TlbMissCounter::TlbMissCounter()
+    : load_fd_(openTlbEvent(PERF_COUNT_HW_CACHE_OP_READ)), store_fd_(openTlbEvent(PERF_COUNT_HW_CACHE_OP_WRITE)) {}
+
+TlbMissCounter::~TlbMissCounter() {
+    if (load_fd_ >= 0) {
+        close(load_fd_);
+    }
+    if (store_fd_ >= 0) {
+        close(store_fd_);
+    }
+}
+
+bool TlbMissCounter::isAvailable() const { return load_fd_ >= 0; }
+
+void TlbMissCounter::start() {
+    for (const auto fd : {load_fd_, store_fd_}) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+long long TlbMissCounter::stop() {
+    long long total = 0;
+    for (const auto fd : {load_fd_, store_fd_}) {
+        long long count = 0;
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) == sizeof(count)) {
+                total += count;
+            }
+        }
+    }
+    return total;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// counts data tlb load and store misses of the thread that constructs it. threads that should be counted together
+// each need their own counter, the counts are summed by the caller.
+class TlbMissCounter {
+   public:
+    TlbMissCounter();
+    ~TlbMissCounter();
+    TlbMissCounter(const TlbMissCounter&) = delete;
+    TlbMissCounter& operator=(const TlbMissCounter&) = delete;
+
+    bool isAvailable() const;  // false if perf_event_open is not permitted or the events are not supported.
+    void start();
+    long long stop();
+
+   private:
+    int load_fd_ = -1;
+    int store_fd_ = -1;
+};
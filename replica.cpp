@@ -0,0 +1,106 @@
+#include "replica.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+static constexpr auto MEDOID_ROUNDS = 16;
+
+static int getCoreHopCost(Topology& topo, int from_core, int to_core) {
+    return topo.getHopCost(from_core, topo.getTileByCore(to_core).cha);
+}
+
+// thread -> index of the closest anchor.
+static std::vector<int> assignThreads(Topology& topo, const std::vector<int>& thread_to_core,
+                                      const std::vector<int>& anchors) {
+    std::vector<int> assignment(thread_to_core.size(), 0);
+    for (int t = 0; t < thread_to_core.size(); ++t) {
+        for (int r = 1; r < anchors.size(); ++r) {
+            if (getCoreHopCost(topo, thread_to_core[t], anchors[r]) <
+                getCoreHopCost(topo, thread_to_core[t], anchors[assignment[t]])) {
+                assignment[t] = r;
+            }
+        }
+    }
+    return assignment;
+}
+
+ReplicaPlan planReplicas(Topology& topo, const std::vector<int>& thread_to_core, int replica_count) {
+    ReplicaPlan plan;
+    replica_count = std::max(1, std::min<int>(replica_count, thread_to_core.size()));
+
+    // farthest point seeding, starting from the core closest to everybody.
+    int center = thread_to_core.front();
+    long center_cost = std::numeric_limits<long>::max();
+    for (const auto core : thread_to_core) {
+        long cost = 0;
+        for (const auto other : thread_to_core) {
+            cost += getCoreHopCost(topo, other, core);
+        }
+        if (cost < center_cost) {
+            center_cost = cost;
+            center = core;
+        }
+    }
+    plan.anchor_cores.push_back(center);
+
+    while (plan.anchor_cores.size() < replica_count) {
+        int farthest = thread_to_core.front();
+        int farthest_cost = -1;
+        for (const auto core : thread_to_core) {
+            int cost = std::numeric_limits<int>::max();
+            for (const auto anchor : plan.anchor_cores) {
+                cost = std::min(cost, getCoreHopCost(topo, core, anchor));
+            }
+            if (cost > farthest_cost) {
+                farthest_cost = cost;
+                farthest = core;
+            }
+        }
+        plan.anchor_cores.push_back(farthest);
+    }
+
+    // move every anchor to the medoid of its region until the regions settle.
+    for (int round = 0; round < MEDOID_ROUNDS; ++round) {
+        plan.thread_replica = assignThreads(topo, thread_to_core, plan.anchor_cores);
+
+        bool moved = false;
+        for (int r = 0; r < replica_count; ++r) {
+            int medoid = plan.anchor_cores[r];
+            long medoid_cost = std::numeric_limits<long>::max();
+            for (int t = 0; t < thread_to_core.size(); ++t) {
+                if (plan.thread_replica[t] != r) {
+                    continue;
+                }
+                long cost = 0;
+                for (int u = 0; u < thread_to_core.size(); ++u) {
+                    if (plan.thread_replica[u] == r) {
+                        cost += getCoreHopCost(topo, thread_to_core[u], thread_to_core[t]);
+                    }
+                }
+                if (cost < medoid_cost) {
+                    medoid_cost = cost;
+                    medoid = thread_to_core[t];
+                }
+            }
+            moved = moved || medoid != plan.anchor_cores[r];
+            plan.anchor_cores[r] = medoid;
+        }
+        if (!moved) {
+            break;
+        }
+    }
+    plan.thread_replica = assignThreads(topo, thread_to_core, plan.anchor_cores);
+
+    for (int r = 0; r < replica_count; ++r) {
+        std::cout << "panel replica " << r << " anchored at core " << plan.anchor_cores[r] << ", read by threads:";
+        for (int t = 0; t < thread_to_core.size(); ++t) {
+            if (plan.thread_replica[t] == r) {
+                std::cout << ' ' << t;
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    return plan;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+#include "topology.hpp"
+
+// where the panel replicas live and which one every thread reads.
+struct ReplicaPlan {
+    std::vector<int> anchor_cores;    // replica r is homed around anchor_cores[r].
+    std::vector<int> thread_replica;  // thread -> replica with the closest anchor.
+};
+
+// splits the cores of thread_to_core into replica_count regions of the mesh (k-medoids on hop cost) and anchors one
+// replica at the medoid core of every region.
+ReplicaPlan planReplicas(Topology& topo, const std::vector<int>& thread_to_core, int replica_count);
@@ -0,0 +1,259 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+// how long an idle thread sleeps before it looks for something to steal again.
+static constexpr auto STEAL_POLL_INTERVAL = std::chrono::microseconds(50);
+
+bool parseSchedule(const std::string& name, Schedule& schedule) {
+    if (name == "barrier") {
+        schedule = Schedule::Barrier;
+    } else if (name == "dataflow") {
+        schedule = Schedule::Dataflow;
+    } else if (name == "steal") {
+        schedule = Schedule::Steal;
+    } else if (name == "lookahead") {
+        schedule = Schedule::Lookahead;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+DataflowScheduler::DataflowScheduler(long nblocks, long thread_count, const std::vector<long>& owners,
+                                     const std::vector<std::vector<long>>& victims)
+    : nblocks_(nblocks),
+      thread_count_(thread_count),
+      owners_(owners),
+      blocks_(new BlockState[nblocks * nblocks]),
+      queues_(new TaskQueue[thread_count]),
+      factored_(0),
+      column_solved_(new std::atomic<long>[nblocks]),
+      row_solved_(new std::atomic<long>[nblocks]),
+      remaining_(0),
+      victims_(victims),
+      steal_counts_(new long[thread_count]()) {
+    long tasks = 0;
+    for (long J = 0; J < nblocks_; ++J) {
+        for (long I = 0; I < nblocks_; ++I) {
+            tasks += std::min(I, J) + 1;
+        }
+    }
+    remaining_ = tasks;
+    for (long b = 0; b < nblocks_; ++b) {
+        column_solved_[b] = 0;
+        row_solved_[b] = 0;
+    }
+    if (nblocks_ > 0) {
+        release(0, 0);
+    }
+}
+
+// the task of block (I, J) after step tasks on it, false if it has none left.
+bool DataflowScheduler::getNextTask(long I, long J, long step, BlockTask& task) const {
+    const long last = std::min(I, J);
+    if (step > last) {
+        return false;
+    }
+    task.I = I;
+    task.J = J;
+    task.K = step;
+    if (step < last) {
+        task.kind = BlockTaskKind::Update;
+    } else if (I == J) {
+        task.kind = BlockTaskKind::Factor;
+    } else if (I > J) {
+        task.kind = BlockTaskKind::SolveColumn;
+    } else {
+        task.kind = BlockTaskKind::SolveRow;
+    }
+    return true;
+}
+
+bool DataflowScheduler::isReady(const BlockTask& task) const {
+    switch (task.kind) {
+        case BlockTaskKind::Factor:
+            return true;  // its updates are done.
+        case BlockTaskKind::SolveColumn:
+        case BlockTaskKind::SolveRow:
+            return factored_.load(std::memory_order_acquire) > task.K;
+        case BlockTaskKind::Update:
+            return column_solved_[task.I].load(std::memory_order_acquire) > task.K &&
+                   row_solved_[task.J].load(std::memory_order_acquire) > task.K;
+    }
+    return false;
+}
+
+// queues the next task of block (I, J) if it is ready. every event a task waits for calls this after publishing
+// itself, and the checks of one block are serialized by its mutex, so the last event always sees the others.
+void DataflowScheduler::release(long I, long J) {
+    auto& block = blocks_[I + J * nblocks_];
+    BlockTask task;
+    {
+        std::lock_guard lock(block.mutex);
+        if (block.queued || !getNextTask(I, J, block.step, task) || !isReady(task)) {
+            return;
+        }
+        block.queued = true;
+    }
+
+    auto& queue = queues_[owners_[I + J * nblocks_]];
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push({2 * task.K + (task.kind == BlockTaskKind::Update ? 1 : 0), task});
+    }
+    queue.ready.notify_one();
+}
+
+bool DataflowScheduler::next(long thread, BlockTask& task) {
+    auto& queue = queues_[thread];
+    const auto has_work = [&] { return !queue.tasks.empty() || remaining_.load() == 0; };
+    for (;;) {
+        {
+            std::unique_lock lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = queue.tasks.top().task;
+                queue.tasks.pop();
+                return true;
+            }
+            if (remaining_.load() == 0) {
+                return false;
+            }
+        }
+
+        if (steal(thread, task)) {
+            ++steal_counts_[thread];
+            return true;
+        }
+
+        std::unique_lock lock(queue.mutex);
+        if (victims_.empty()) {
+            queue.ready.wait(lock, has_work);
+        } else {
+            // nobody signals this thread when a victim gets work.
+            queue.ready.wait_for(lock, STEAL_POLL_INTERVAL, has_work);
+        }
+    }
+}
+
+// the next update of the first victim whose next task is one.
+bool DataflowScheduler::steal(long thread, BlockTask& task) {
+    if (victims_.empty()) {
+        return false;
+    }
+    for (const auto victim : victims_[thread]) {
+        auto& queue = queues_[victim];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.tasks.empty() && queue.tasks.top().task.kind == BlockTaskKind::Update) {
+            task = queue.tasks.top().task;
+            queue.tasks.pop();
+            return true;
+        }
+    }
+    return false;
+}
+
+void DataflowScheduler::complete(const BlockTask& task) {
+    {
+        auto& block = blocks_[task.I + task.J * nblocks_];
+        std::lock_guard lock(block.mutex);
+        ++block.step;
+        block.queued = false;
+    }
+
+    switch (task.kind) {
+        case BlockTaskKind::Factor:
+            factored_.store(task.K + 1, std::memory_order_release);
+            for (long b = task.K + 1; b < nblocks_; ++b) {
+                release(b, task.K);
+                release(task.K, b);
+            }
+            break;
+        case BlockTaskKind::SolveColumn:
+            column_solved_[task.I].store(task.K + 1, std::memory_order_release);
+            for (long J = task.K + 1; J < nblocks_; ++J) {
+                release(task.I, J);
+            }
+            break;
+        case BlockTaskKind::SolveRow:
+            row_solved_[task.J].store(task.K + 1, std::memory_order_release);
+            for (long I = task.K + 1; I < nblocks_; ++I) {
+                release(I, task.J);
+            }
+            break;
+        case BlockTaskKind::Update:
+            release(task.I, task.J);
+            break;
+    }
+
+    if (--remaining_ == 0) {
+        for (long thread = 0; thread < thread_count_; ++thread) {
+            std::lock_guard lock(queues_[thread].mutex);
+            queues_[thread].ready.notify_all();
+        }
+    }
+}
+
+LookaheadProgress::LookaheadProgress(long nblocks, long depth)
+    : nblocks_(nblocks),
+      depth_(depth),
+      diagonals_(0),
+      panels_(0),
+      solved_(new std::atomic<long>[nblocks]),
+      step_done_(new std::atomic<long>[nblocks]),
+      block_steps_(nblocks * nblocks, 0) {
+    for (long K = 0; K < nblocks; ++K) {
+        solved_[K] = 0;
+        step_done_[K] = 0;
+    }
+}
+
+long LookaheadProgress::getFactoredDiagonals() const {
+    return diagonals_.load(std::memory_order_acquire);
+}
+
+void LookaheadProgress::markDiagonalFactored(long K) {
+    diagonals_.store(K + 1, std::memory_order_release);
+    if (K == nblocks_ - 1) {
+        panels_.store(K + 1, std::memory_order_release);  // no perimeter.
+    }
+}
+
+long LookaheadProgress::getFactoredPanels() const {
+    return panels_.load(std::memory_order_acquire);
+}
+
+void LookaheadProgress::markPerimeterSolved(long K) {
+    if (solved_[K].fetch_add(1, std::memory_order_acq_rel) + 1 == 2 * (nblocks_ - K - 1)) {
+        panels_.store(K + 1, std::memory_order_release);
+    }
+}
+
+void LookaheadProgress::markStepDone(long K) {
+    step_done_[K].fetch_add(1, std::memory_order_acq_rel);
+}
+
+bool LookaheadProgress::mayFactor(long K, long thread_count) const {
+    const long behind = K - 1 - depth_;
+    return behind < 0 || step_done_[behind].load(std::memory_order_acquire) == thread_count;
+}
+
+std::vector<std::vector<long>> getStealOrder(Topology& topo, const std::vector<int>& thread_to_core) {
+    const long thread_count = thread_to_core.size();
+    std::vector<std::vector<long>> victims(thread_count);
+    for (long thread = 0; thread < thread_count; ++thread) {
+        std::vector<std::pair<int, long>> costs;  // (hops, victim)
+        for (long victim = 0; victim < thread_count; ++victim) {
+            if (victim != thread) {
+                const auto cha = topo.getTileByCore(thread_to_core[victim]).cha;
+                costs.emplace_back(topo.getHopCost(thread_to_core[thread], cha), victim);
+            }
+        }
+        std::stable_sort(costs.begin(), costs.end());
+        for (const auto& cost : costs) {
+            victims[thread].push_back(cost.second);
+        }
+    }
+    return victims;
+}
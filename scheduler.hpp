@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "topology.hpp"
+
+// how lu orders the block operations. Barrier is the classic step by step loop with a barrier after the diagonal
+// block and after the perimeter of every K, Dataflow runs every block operation as soon as its inputs are ready,
+// Steal is Dataflow with idle threads stealing updates from others, Lookahead factors the next panels early on their
+// owners while the trailing updates before them finish.
+enum class Schedule { Barrier, Dataflow, Steal, Lookahead };
+
+// "barrier", "dataflow", "steal" or "lookahead".
+bool parseSchedule(const std::string& name, Schedule& schedule);
+
+// lu0, bdiv, bmodd and bmod.
+enum class BlockTaskKind { Factor, SolveColumn, SolveRow, Update };
+
+// operation on block (I, J) in step K. Factor is (K, K), SolveColumn (I, K), SolveRow (K, J), Update (I, J) with the
+// panel blocks (I, K) and (K, J).
+struct BlockTask {
+    BlockTaskKind kind;
+    long I;
+    long J;
+    long K;
+};
+
+// the blocked lu as a dag of block tasks. every block knows how many steps it went through, a task is released to the
+// queue of the block's owner once the panel blocks it reads are final: the diagonal block of its step for the panel
+// tasks, the column and row panel blocks of its step for updates. the panels of a column (row) are finished in K
+// order, so one counter per block row (column) says how far they are. owners pick the lowest K first, panel tasks
+// before updates, which lets the next diagonal block start while the trailing update of K still runs.
+// with victims, a thread whose queue is empty takes the next update from the first victim that has one ready. panel
+// tasks always stay with their owner.
+class DataflowScheduler {
+public:
+    // owners[I + J * nblocks] runs block (I, J). victims[thread] lists the threads it may steal from, in order of
+    // preference, no stealing if empty.
+    DataflowScheduler(long nblocks, long thread_count, const std::vector<long>& owners,
+                      const std::vector<std::vector<long>>& victims = {});
+
+    // the next task of thread, waits until one is ready. false once the factorization is done.
+    bool next(long thread, BlockTask& task);
+
+    // publishes the result of a task from next and releases the tasks waiting for it.
+    void complete(const BlockTask& task);
+
+    // updates thread took from other threads.
+    long getStealCount(long thread) const { return steal_counts_[thread]; }
+
+private:
+    struct BlockState {
+        std::mutex mutex;
+        long step = 0;  // tasks done on the block.
+        bool queued = false;
+    };
+
+    struct QueuedTask {
+        long priority;
+        BlockTask task;
+        bool operator<(const QueuedTask& other) const { return priority > other.priority; }
+    };
+
+    struct TaskQueue {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::priority_queue<QueuedTask> tasks;
+    };
+
+    bool getNextTask(long I, long J, long step, BlockTask& task) const;
+    bool isReady(const BlockTask& task) const;
+    void release(long I, long J);
+    bool steal(long thread, BlockTask& task);
+
+    long nblocks_;
+    long thread_count_;
+    std::vector<long> owners_;
+    std::unique_ptr<BlockState[]> blocks_;
+    std::unique_ptr<TaskQueue[]> queues_;
+    std::atomic<long> factored_;                         // diagonal blocks done.
+    std::unique_ptr<std::atomic<long>[]> column_solved_;  // [I]: column panel blocks (I, K) done.
+    std::unique_ptr<std::atomic<long>[]> row_solved_;     // [J]: row panel blocks (K, J) done.
+    std::atomic<long> remaining_;
+    std::vector<std::vector<long>> victims_;
+    std::unique_ptr<long[]> steal_counts_;  // written by their thread only.
+};
+
+// for every thread the other threads, the one whose core is the fewest hops away first. the victims of -xsteal.
+std::vector<std::vector<long>> getStealOrder(Topology& topo, const std::vector<int>& thread_to_core);
+
+// shared state of the lookahead schedule. every block of panel K is factored by its owner as soon as its updates are
+// done, lu0 of the diagonal block first, then bdiv and bmodd of the perimeter. panel K may only start once every
+// thread finished the trailing update of step K - 1 - depth, so up to depth trailing updates are still outstanding
+// while a panel is factored. threads update the blocks of the next depth panels first and do the rest of the trailing
+// update in the order the blocks become panels.
+class LookaheadProgress {
+public:
+    LookaheadProgress(long nblocks, long depth);
+
+    // diagonal blocks 0 .. getFactoredDiagonals() - 1 are factored. they are factored in order.
+    long getFactoredDiagonals() const;
+    void markDiagonalFactored(long K);
+
+    // panels 0 .. getFactoredPanels() - 1 are final, diagonal block and perimeter. they are finished in order.
+    long getFactoredPanels() const;
+    // one perimeter block of panel K is solved.
+    void markPerimeterSolved(long K);
+
+    // threads that applied every update of step K to their blocks.
+    void markStepDone(long K);
+    // whether the blocks of panel K may be factored on a team of thread_count.
+    bool mayFactor(long K, long thread_count) const;
+
+    // operations done on block b so far, its updates and then its panel operation. touched only by the owner of b.
+    long& getBlockStep(long b) { return block_steps_[b]; }
+
+private:
+    long nblocks_;
+    long depth_;
+    std::atomic<long> diagonals_;
+    std::atomic<long> panels_;
+    std::unique_ptr<std::atomic<long>[]> solved_;     // [K]: perimeter blocks of panel K solved.
+    std::unique_ptr<std::atomic<long>[]> step_done_;  // [K]: threads done with step K.
+    std::vector<long> block_steps_;
+};
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "simulator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+
+static std::uint64_t splitmix64(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+CoherenceSimulator::CoherenceSimulator(Topology &topo, const std::vector<int> &thread_to_core, SimulatorConfig config)
+    : config_(config), stats_(thread_to_core.size()) {
+    assert(thread_to_core.size() <= MAX_SIMULATED_THREADS);
+
+    while (topo.getTile(cha_count_).cha != UNDEFINED) {
+        ++cha_count_;
+    }
+    assert(cha_count_ > 0);
+
+    // precompute hop costs, Topology::getHopCost walks the whole mesh on every call.
+    const auto thread_count = thread_to_core.size();
+    thread_cha_cost_.assign(thread_count, std::vector<int>(cha_count_, 0));
+    thread_thread_cost_.assign(thread_count, std::vector<int>(thread_count, 0));
+    for (int t = 0; t < thread_count; ++t) {
+        for (int cha = 0; cha < cha_count_; ++cha) {
+            thread_cha_cost_[t][cha] = topo.getHopCost(thread_to_core[t], cha);
+        }
+        for (int u = 0; u < thread_count; ++u) {
+            // every core shares its tile with a cha, so core to core cost is core to the other core's cha.
+            thread_thread_cost_[t][u] = topo.getHopCost(thread_to_core[t], topo.getTileByCore(thread_to_core[u]).cha);
+        }
+    }
+}
+
+int CoherenceSimulator::getHome(std::uint64_t line, const Trace &trace) const {
+    if (!config_.synthetic_homes) {
+        const auto it = trace.homes.find(line);
+        if (it != trace.homes.end() && it->second >= 0 && it->second < cha_count_) {
+            return it->second;
+        }
+    }
+    return static_cast<int>(splitmix64(line >> 6) % cha_count_);
+}
+
+void CoherenceSimulator::run(const Trace &trace) {
+    for (const auto &rec : trace.records) {
+        if (rec.thread >= stats_.size()) {
+            std::cerr << "trace has more threads than the mapping, skipping thread " << rec.thread << '\n';
+            continue;
+        }
+
+        const int home = getHome(rec.line, trace);
+        auto &entry = directory_[rec.line];
+        auto &stats = stats_[rec.thread];
+
+        ++stats.accesses;
+        const auto cycles = rec.is_write ? write(rec.thread, home, entry) : read(rec.thread, home, entry);
+        if (cycles == 0) {
+            ++stats.hits;
+        } else {
+            ++stats.misses;
+            stats.stall_cycles += cycles;
+        }
+    }
+}
+
+long CoherenceSimulator::read(int thread, int home, DirectoryEntry &entry) {
+    const long request = config_.cha_lookup_cycles + thread_cha_cost_[thread][home];
+
+    switch (entry.state) {
+        case LineState::Invalid:
+            entry.state = LineState::Exclusive;
+            entry.owner = thread;
+            entry.sharers.reset();
+            entry.sharers.set(thread);
+            return request + thread_cha_cost_[thread][home];
+        case LineState::Shared:
+            if (entry.sharers.test(thread)) {
+                return 0;
+            }
+            entry.sharers.set(thread);
+            return request + thread_cha_cost_[thread][home];
+        case LineState::Exclusive:
+        case LineState::Modified: {
+            if (entry.owner == thread) {
+                return 0;
+            }
+            // requester -> home -> owner -> requester, owner keeps a shared copy.
+            const int owner = entry.owner;
+            ++stats_[thread].forwards;
+            entry.state = LineState::Shared;
+            entry.owner = UNDEFINED;
+            entry.sharers.set(thread);
+            return request + thread_cha_cost_[owner][home] + thread_thread_cost_[owner][thread];
+        }
+    }
+
+    return 0;
+}
+
+// invalidations go out in parallel, so only the farthest sharer's round trip from home counts.
+long CoherenceSimulator::invalidateSharers(int thread, int home, DirectoryEntry &entry) {
+    long farthest = 0;
+    for (int t = 0; t < stats_.size(); ++t) {
+        if (t != thread && entry.sharers.test(t)) {
+            farthest = std::max<long>(farthest, 2 * thread_cha_cost_[t][home]);
+            ++stats_[thread].invalidations;
+        }
+    }
+    return farthest;
+}
+
+long CoherenceSimulator::write(int thread, int home, DirectoryEntry &entry) {
+    const long request = config_.cha_lookup_cycles + thread_cha_cost_[thread][home];
+    long cycles = 0;
+
+    switch (entry.state) {
+        case LineState::Invalid:
+            cycles = request + thread_cha_cost_[thread][home];
+            break;
+        case LineState::Shared:
+            cycles = request + invalidateSharers(thread, home, entry) + thread_cha_cost_[thread][home];
+            break;
+        case LineState::Exclusive:
+        case LineState::Modified:
+            if (entry.owner == thread) {
+                entry.state = LineState::Modified;  // silent E -> M upgrade.
+                return 0;
+            }
+            ++stats_[thread].forwards;
+            ++stats_[thread].invalidations;
+            cycles = request + thread_cha_cost_[entry.owner][home] + thread_thread_cost_[entry.owner][thread];
+            break;
+    }
+
+    entry.state = LineState::Modified;
+    entry.owner = thread;
+    entry.sharers.reset();
+    entry.sharers.set(thread);
+    return cycles;
+}
+
+const std::vector<ThreadStats> &CoherenceSimulator::getStats() const { return stats_; }
+
+void CoherenceSimulator::printStats(const char *name, bool per_thread) const {
+    ThreadStats total;
+    long max_stall = 0;
+    for (const auto &stats : stats_) {
+        total.accesses += stats.accesses;
+        total.hits += stats.hits;
+        total.misses += stats.misses;
+        total.forwards += stats.forwards;
+        total.invalidations += stats.invalidations;
+        total.stall_cycles += stats.stall_cycles;
+        max_stall = std::max(max_stall, stats.stall_cycles);
+    }
+
+    printf("mapping %s\n", name);
+    printf(" Thread       Accesses        Misses      Forwards   Invalidates  Stall cycles\n");
+    if (per_thread) {
+        for (int t = 0; t < stats_.size(); ++t) {
+            const auto &stats = stats_[t];
+            printf("  %5d  %13ld %13ld %13ld %13ld %13ld\n", t, stats.accesses, stats.misses, stats.forwards,
+                   stats.invalidations, stats.stall_cycles);
+        }
+    }
+    printf("  Total  %13ld %13ld %13ld %13ld %13ld\n", total.accesses, total.misses, total.forwards,
+           total.invalidations, total.stall_cycles);
+    printf("  Max stall of a single thread: %ld cycles\n\n", max_stall);
+}
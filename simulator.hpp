@@ -0,0 +1,56 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "topology.hpp"
+#include "trace.hpp"
+
+static constexpr auto MAX_SIMULATED_THREADS = 256;
+
+struct SimulatorConfig {
+    int cha_lookup_cycles = 20;    // directory/llc lookup at the home cha, charged once per miss.
+    bool synthetic_homes = false;  // ignore homes stored in the trace and hash lines onto chas instead.
+};
+
+struct ThreadStats {
+    long accesses = 0;
+    long hits = 0;
+    long misses = 0;
+    long forwards = 0;       // misses served by another core's cache (3-hop transactions).
+    long invalidations = 0;  // copies this thread invalidated in other cores' caches.
+    long stall_cycles = 0;
+};
+
+// directory-at-cha MESI model with infinite private caches: only coherence and cold misses are simulated. the cost of
+// a miss is the cha lookup plus the mesh hop costs of the messages involved, taken from Topology.
+class CoherenceSimulator {
+   public:
+    CoherenceSimulator(Topology& topo, const std::vector<int>& thread_to_core, SimulatorConfig config = {});
+    void run(const Trace& trace);
+    const std::vector<ThreadStats>& getStats() const;
+    void printStats(const char* name, bool per_thread) const;
+
+   private:
+    enum class LineState { Invalid, Shared, Exclusive, Modified };
+
+    struct DirectoryEntry {
+        LineState state = LineState::Invalid;
+        int owner = UNDEFINED;
+        std::bitset<MAX_SIMULATED_THREADS> sharers;
+    };
+
+    int getHome(std::uint64_t line, const Trace& trace) const;
+    long read(int thread, int home, DirectoryEntry& entry);
+    long write(int thread, int home, DirectoryEntry& entry);
+    long invalidateSharers(int thread, int home, DirectoryEntry& entry);
+
+    SimulatorConfig config_;
+    int cha_count_ = 0;
+    std::vector<std::vector<int>> thread_cha_cost_;     // [thread][cha]
+    std::vector<std::vector<int>> thread_thread_cost_;  // [thread][thread]
+    std::unordered_map<std::uint64_t, DirectoryEntry> directory_;
+    std::vector<ThreadStats> stats_;
+};
@@ -0,0 +1,271 @@
+#include "slice_allocator.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "cha.hpp"
+
+static constexpr std::size_t CACHE_LINE_SIZE = 64;
+static constexpr std::size_t PAGE_SIZE = 4096;
+static constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+static constexpr std::size_t POOL_OVERSUBSCRIPTION = 4;  // pool chunks per requested chunk, up to a window.
+static constexpr std::size_t MAX_WINDOW_SIZE = 512 * 1024 * 1024;
+static constexpr std::size_t MAX_OPEN_WINDOWS = 2;
+
+SliceAllocator::SliceAllocator(Topology& topo, std::size_t chunk_size, std::size_t chunk_count)
+    : topo_(topo),
+      chunk_size_((chunk_size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE),
+      chunk_count_(chunk_count) {
+    window_size_ = std::min(chunk_size_ * chunk_count_ * POOL_OVERSUBSCRIPTION, MAX_WINDOW_SIZE);
+    window_size_ = std::max(window_size_, chunk_size_);
+    window_size_ = (window_size_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+    for (int cha = 0; topo_.getTile(cha).cha != UNDEFINED; ++cha) {
+        if (topo_.getTile(cha).core != UNDEFINED) {
+            cores_.push_back(topo_.getTile(cha).core);
+        }
+    }
+
+    resolved_ = getuid() == 0;
+    if (!resolved_) {
+        std::cout << "slice allocator needs root to read the pagemap. handing out chunks in address order."
+                  << std::endl;
+    }
+}
+
+SliceAllocator::~SliceAllocator() {
+    // only what is still mapped, the released ranges may belong to someone else by now.
+    for (const auto& window : windows_) {
+        for (const auto& [begin, end] : window.mapped) {
+            munmap(window.base + begin, end - begin);
+        }
+    }
+}
+
+void SliceAllocator::openWindow() {
+    Window window;
+    window.size = window_size_;
+    window.chunk_count = window.size / chunk_size_;
+
+    // huge pages give the hash more physical address bits to work with per chunk and cut the pagemap lookups.
+    void* base = mmap(nullptr, window.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    window.huge_pages = base != MAP_FAILED;
+    if (!window.huge_pages) {
+        base = mmap(nullptr, window.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            std::cerr << "slice allocator could not map " << window.size << " bytes.\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+    window.base = static_cast<char*>(base);
+    std::memset(window.base, 0, window.size);  // physical pages have to exist before they can be resolved.
+    mapped_size_ += window.size;
+    window.mapped = {{0, window.size}};
+
+    window.allocated.assign(window.chunk_count, false);
+    window.free_count = window.chunk_count;
+    if (resolved_) {
+        scoreChunks(window);
+    }
+    windows_.push_back(std::move(window));
+}
+
+void SliceAllocator::scoreChunks(Window& window) {
+    int cha_count = 0;
+    while (topo_.getTile(cha_count).cha != UNDEFINED) {
+        ++cha_count;
+    }
+
+    std::vector<std::vector<int>> core_cha_cost(cores_.size(), std::vector<int>(cha_count));
+    for (int k = 0; k < cores_.size(); ++k) {
+        for (int cha = 0; cha < cha_count; ++cha) {
+            core_cha_cost[k][cha] = topo_.getHopCost(cores_[k], cha);
+        }
+    }
+
+    window.chunk_costs.assign(window.chunk_count, std::vector<int>(cores_.size(), 0));
+    window.mean_costs.assign(cores_.size(), 0.0);
+    std::map<int, std::vector<std::pair<int, std::size_t>>> buckets;  // best core -> (cost, chunk)
+
+    // pagemap is read once per page, the hash is evaluated per line.
+    std::uintptr_t cached_page = 0;
+    std::uintptr_t cached_physical_page = 0;
+
+    for (std::size_t c = 0; c < window.chunk_count; ++c) {
+        std::vector<int> histogram(cha_count, 0);
+        const auto first = reinterpret_cast<std::uintptr_t>(window.base + c * chunk_size_);
+        for (auto line = first; line < first + chunk_size_; line += CACHE_LINE_SIZE) {
+            const auto page = line & ~(PAGE_SIZE - 1);
+            if (page != cached_page) {
+                cached_page = page;
+                cached_physical_page = getPhysicalAddress(page);
+            }
+            const int cha = findCHAByPhysicalAddress(cached_physical_page + (line - page));
+            if (cha >= 0 && cha < cha_count) {
+                ++histogram[cha];
+            }
+        }
+
+        auto& costs = window.chunk_costs[c];
+        int best = 0;
+        for (int k = 0; k < cores_.size(); ++k) {
+            for (int cha = 0; cha < cha_count; ++cha) {
+                costs[k] += histogram[cha] * core_cha_cost[k][cha];
+            }
+            window.mean_costs[k] += static_cast<double>(costs[k]) / window.chunk_count;
+            if (costs[k] < costs[best]) {
+                best = k;
+            }
+        }
+        buckets[best].emplace_back(costs[best], c);
+    }
+
+    for (auto& [k, chunks] : buckets) {
+        std::sort(chunks.begin(), chunks.end());
+        for (const auto& [cost, c] : chunks) {
+            window.free_chunks[k].push_back(c);
+        }
+    }
+}
+
+int SliceAllocator::getCoreIndex(int core) {
+    const auto it = std::find(cores_.begin(), cores_.end(), core);
+    return it == cores_.end() ? -1 : it - cores_.begin();
+}
+
+void* SliceAllocator::take(Window& window, std::size_t chunk, int k) {
+    window.allocated[chunk] = true;
+    --window.free_count;
+    ++allocated_count_;
+    if (resolved_ && k != -1) {
+        allocated_cost_ += window.chunk_costs[chunk][k];
+        baseline_cost_ += window.mean_costs[k];
+    }
+    return window.base + chunk * chunk_size_;
+}
+
+void* SliceAllocator::allocate(int core) {
+    if (closed_ || static_cast<std::size_t>(allocated_count_) == chunk_count_) {
+        return nullptr;
+    }
+
+    const std::size_t open_windows =
+        std::count_if(windows_.begin(), windows_.end(), [](const Window& window) { return window.free_count > 0; });
+    const int k = getCoreIndex(core);
+    if (!resolved_ || k == -1) {
+        if (open_windows == 0) {
+            openWindow();
+        }
+        for (auto& window : windows_) {
+            while (window.next_chunk < window.chunk_count && window.allocated[window.next_chunk]) {
+                ++window.next_chunk;
+            }
+            if (window.next_chunk < window.chunk_count) {
+                // drop it from its bucket too, if it has one.
+                for (auto& [other, chunks] : window.free_chunks) {
+                    const auto it = std::find(chunks.begin(), chunks.end(), window.next_chunk);
+                    if (it != chunks.end()) {
+                        chunks.erase(it);
+                        break;
+                    }
+                }
+                return take(window, window.next_chunk, k);
+            }
+        }
+        return nullptr;
+    }
+
+    // the core's own buckets first, a new window while few are open, then the cheapest head of the other buckets.
+    std::deque<std::size_t>* bucket = nullptr;
+    Window* owner = nullptr;
+    for (auto& window : windows_) {
+        auto it = window.free_chunks.find(k);
+        if (it != window.free_chunks.end() && !it->second.empty() &&
+            (bucket == nullptr ||
+             window.chunk_costs[it->second.front()][k] < owner->chunk_costs[bucket->front()][k])) {
+            bucket = &it->second;
+            owner = &window;
+        }
+    }
+    if (bucket == nullptr && open_windows < MAX_OPEN_WINDOWS) {
+        openWindow();
+        return allocate(core);
+    }
+    for (auto& window : windows_) {
+        for (auto& [other, chunks] : window.free_chunks) {
+            if (!chunks.empty() &&
+                (bucket == nullptr || window.chunk_costs[chunks.front()][k] < owner->chunk_costs[bucket->front()][k])) {
+                bucket = &chunks;
+                owner = &window;
+            }
+        }
+    }
+    if (bucket == nullptr) {
+        return nullptr;
+    }
+
+    const auto c = bucket->front();
+    bucket->pop_front();
+    return take(*owner, c, k);
+}
+
+void SliceAllocator::releaseUnused() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;  // released pages would come back on other physical addresses, the scores would be stale.
+
+    for (auto& window : windows_) {
+        const std::size_t page_size = window.huge_pages ? HUGE_PAGE_SIZE : PAGE_SIZE;
+        std::size_t free_begin = 0;  // of the run of unused pages that ends at page.
+        std::size_t used_begin = 0;  // of the run of used pages before it.
+        window.mapped.clear();
+        for (std::size_t page = 0; page <= window.size; page += page_size) {
+            bool used = page == window.size;  // closes the last run.
+            const auto first_chunk = page / chunk_size_;
+            const auto last_chunk = std::min(window.chunk_count, (page + page_size + chunk_size_ - 1) / chunk_size_);
+            for (auto c = first_chunk; c < last_chunk && !used; ++c) {
+                used = window.allocated[c];
+            }
+            if (!used) {
+                continue;
+            }
+            if (page > free_begin) {
+                munmap(window.base + free_begin, page - free_begin);
+                released_size_ += page - free_begin;
+                if (free_begin > used_begin) {
+                    window.mapped.emplace_back(used_begin, free_begin);
+                }
+                used_begin = page;
+            }
+            free_begin = page + page_size;
+        }
+        if (window.size > used_begin) {
+            window.mapped.emplace_back(used_begin, window.size);
+        }
+        window.free_chunks.clear();
+        window.free_count = 0;
+    }
+    std::cout << "slice allocator released " << released_size_ / 1024 << " KiB of unused pool." << std::endl;
+}
+
+void SliceAllocator::printStats() const {
+    std::size_t huge_windows = 0;
+    for (const auto& window : windows_) {
+        huge_windows += window.huge_pages;
+    }
+    std::cout << "slice allocator: " << allocated_count_ << " chunks of " << chunk_size_ << " bytes handed out from "
+              << windows_.size() << " windows of " << window_size_ / 1024 << " KiB (" << huge_windows
+              << " on 2 MiB pages), " << (mapped_size_ - released_size_) / 1024 << " KiB still mapped." << std::endl;
+    if (resolved_ && allocated_count_ > 0) {
+        std::cout << "line weighted hop cost of handed out chunks: " << allocated_cost_
+                  << " (average window chunks: " << static_cast<long>(baseline_cost_) << ")" << std::endl;
+    }
+}
+
+std::size_t SliceAllocator::getChunkSize() const { return chunk_size_; }
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "topology.hpp"
+
+// hands out fixed size chunks (e.g. the storage of one matrix block) whose cache lines are homed on chas close to a
+// requested core. the pool is mapped in windows of at most MAX_WINDOW_SIZE, huge pages if possible, each pre-faulted
+// and every chunk scored by resolving its lines with the pagemap and the slice hash of cha.cpp. that needs root,
+// without it chunks are handed out in address order. a request takes the cheapest chunk for its core of the open
+// windows, a new window is only mapped while fewer than MAX_OPEN_WINDOWS have free chunks, so the pool stays within
+// a few windows of what is handed out.
+class SliceAllocator {
+   public:
+    SliceAllocator(Topology& topo, std::size_t chunk_size, std::size_t chunk_count);
+    ~SliceAllocator();
+    SliceAllocator(const SliceAllocator&) = delete;
+    SliceAllocator& operator=(const SliceAllocator&) = delete;
+
+    // nullptr once chunk_count chunks are handed out or the pool is released.
+    void* allocate(int core);
+    // unmaps the pages (4 KiB or 2 MiB) without an allocated chunk and closes the pool.
+    void releaseUnused();
+    void printStats() const;
+    std::size_t getChunkSize() const;
+
+   private:
+    struct Window {
+        char* base = nullptr;
+        std::size_t size = 0;
+        std::size_t chunk_count = 0;
+        bool huge_pages = false;
+        std::vector<std::vector<int>> chunk_costs;           // [chunk][index into cores_], line weighted hops.
+        std::vector<double> mean_costs;                      // [index into cores_], over the window.
+        std::map<int, std::deque<std::size_t>> free_chunks;  // best core index -> chunks, cheapest first.
+        std::vector<bool> allocated;
+        std::size_t next_chunk = 0;                          // address order, used when chunks cannot be resolved.
+        std::size_t free_count = 0;
+        std::vector<std::pair<std::size_t, std::size_t>> mapped;  // [begin, end) offsets not released yet.
+    };
+
+    void openWindow();
+    void scoreChunks(Window& window);
+    void* take(Window& window, std::size_t chunk, int k);
+    int getCoreIndex(int core);
+
+    Topology& topo_;
+    std::size_t chunk_size_;
+    std::size_t chunk_count_;   // chunks that may be handed out.
+    std::size_t window_size_;
+    bool resolved_ = false;
+    bool closed_ = false;
+
+    std::vector<int> cores_;  // cores that sit on a tile.
+    std::vector<Window> windows_;
+    long allocated_count_ = 0;
+    long allocated_cost_ = 0;
+    double baseline_cost_ = 0.0;  // what the same requests cost on average window chunks.
+    std::size_t mapped_size_ = 0;
+    std::size_t released_size_ = 0;
+};
@@ -0,0 +1,83 @@
+#include "thread_pool.hpp"
+
+#include "cha.hpp"
+
+// pause iterations a thread spins on the next job (or the end of one) before it goes to sleep.
+static constexpr auto SPIN_LIMIT = 4096;
+
+ThreadPool::ThreadPool(long thread_count) : thread_count_(thread_count), pinned_(thread_count, -1) {
+    for (long thread = 1; thread < thread_count_; ++thread) {
+        workers_.emplace_back(&ThreadPool::work, this, thread);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+    posted_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(const std::vector<int>& cores, const std::function<void(long)>& job) {
+    cores_ = cores;
+    job_ = &job;
+    pending_.store(thread_count_ - 1, std::memory_order_relaxed);
+    {
+        std::lock_guard lock(mutex_);
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+    posted_.notify_all();
+
+    runJob(0);
+
+    for (int spin = 0; spin < SPIN_LIMIT; ++spin) {
+        if (pending_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+        __builtin_ia32_pause();
+    }
+    std::unique_lock lock(mutex_);
+    finished_.wait(lock, [&] { return pending_.load(std::memory_order_acquire) == 0; });
+}
+
+void ThreadPool::work(long thread) {
+    long seen = 0;
+    for (;;) {
+        seen = waitForJob(seen);
+        if (stopping_) {
+            return;
+        }
+        runJob(thread);
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard lock(mutex_);
+            finished_.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runJob(long thread) {
+    if (pinned_[thread] != cores_[thread]) {
+        stick_this_thread_to_core(cores_[thread]);
+        pinned_[thread] = cores_[thread];
+    }
+    (*job_)(thread);
+}
+
+// the generation of the next job after seen.
+long ThreadPool::waitForJob(long seen) {
+    for (int spin = 0; spin < SPIN_LIMIT; ++spin) {
+        const long generation = generation_.load(std::memory_order_acquire);
+        if (generation != seen) {
+            return generation;
+        }
+        __builtin_ia32_pause();
+    }
+    std::unique_lock lock(mutex_);
+    posted_.wait(lock, [&] { return generation_.load(std::memory_order_acquire) != seen; });
+    return generation_.load(std::memory_order_acquire);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a fixed team of threads that runs one job after another. the thread calling run takes part as thread 0, the others
+// live as long as the pool. every job says which core each thread runs on, a thread only re-pins when its core
+// changed. idle threads spin on the next job for a while, then sleep on a condition variable.
+class ThreadPool {
+public:
+    explicit ThreadPool(long thread_count);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // runs job(thread) on every thread, thread pinned to cores[thread], and returns when all are done.
+    void run(const std::vector<int>& cores, const std::function<void(long)>& job);
+
+    long getThreadCount() const { return thread_count_; }
+
+private:
+    void work(long thread);
+    void runJob(long thread);
+    long waitForJob(long seen);
+
+    long thread_count_;
+    std::vector<std::thread> workers_;
+    std::vector<int> pinned_;  // [thread]: core it is pinned to, -1 before its first job. touched by its thread only.
+    std::vector<int> cores_;
+    const std::function<void(long)>* job_ = nullptr;
+    bool stopping_ = false;
+    std::mutex mutex_;
+    std::condition_variable posted_;
+    std::condition_variable finished_;
+    alignas(64) std::atomic<long> generation_{0};  // jobs posted.
+    alignas(64) std::atomic<long> pending_{0};     // workers still in the current job.
+};
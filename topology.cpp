@@ -4,14 +4,12 @@
 #include <bitset>
 #include <cassert>
 #include <cmath>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <queue>
 #include <sstream>
 
-static constexpr auto VERTICAL_HOP_CYCLE_COST = 1;
-static constexpr auto HORIZONTAL_HOP_CYCLE_COST = 2;
-
 static constexpr auto SKX_CPU_ROW_COUNT = 5;
 static constexpr auto SKX_CPU_COL_COUNT = 6;
 static constexpr auto SKX_CPU_IMC_COUNT = 2;
@@ -63,6 +61,78 @@ Topology::Topology(const std::map<int, int> &cha_core_map, std::uint32_t capid6)
     // TODO: make sure disabled count is same in both halves. assert().
 }
 
+Topology::Topology(const MeshConfig &config) : Topology(config.cha_core_map, config.capid6) {
+    vertical_hop_cost_ = config.vertical_hop_cost;
+    horizontal_hop_cost_ = config.horizontal_hop_cost;
+    base_latency_ = config.base_latency;
+}
+
+// plain "key value..." lines, '#' starts a comment. keys that are missing keep their defaults.
+bool loadMeshConfig(const std::string &filename, MeshConfig &config) {
+    std::ifstream infile(filename);
+    if (!infile) {
+        std::cerr << "could not open mesh config " << filename << '\n';
+        return false;
+    }
+
+    bool cha_core_map_seen = false;
+    std::string line;
+    while (std::getline(infile, line)) {
+        std::istringstream iss(line);
+        std::string key;
+        if (!(iss >> key) || key[0] == '#') {
+            continue;
+        }
+
+        if (key == "capid6") {
+            iss >> std::hex >> config.capid6;
+        } else if (key == "vertical_hop_cost") {
+            iss >> config.vertical_hop_cost;
+        } else if (key == "horizontal_hop_cost") {
+            iss >> config.horizontal_hop_cost;
+        } else if (key == "base_latency") {
+            iss >> config.base_latency;
+        } else if (key == "cha_core") {
+            if (!cha_core_map_seen) {
+                config.cha_core_map.clear();  // a config that lists cha_core entries replaces the whole table.
+                cha_core_map_seen = true;
+            }
+            int cha, core;
+            iss >> cha >> core;
+            config.cha_core_map[cha] = core;
+        } else {
+            std::cerr << "unknown mesh config key " << key << " in " << filename << '\n';
+            return false;
+        }
+
+        if (iss.fail()) {
+            std::cerr << "malformed mesh config line: " << line << '\n';
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool saveMeshConfig(const std::string &filename, const MeshConfig &config) {
+    std::ofstream outfile(filename);
+    if (!outfile) {
+        std::cerr << "could not write mesh config " << filename << '\n';
+        return false;
+    }
+
+    outfile << "# mesh configuration, consumed by Topology(const MeshConfig&).\n";
+    outfile << "capid6 0x" << std::hex << std::setw(8) << std::setfill('0') << config.capid6 << std::dec << '\n';
+    outfile << "vertical_hop_cost " << config.vertical_hop_cost << '\n';
+    outfile << "horizontal_hop_cost " << config.horizontal_hop_cost << '\n';
+    outfile << "base_latency " << config.base_latency << '\n';
+    for (const auto &[cha, core] : config.cha_core_map) {
+        outfile << "cha_core " << cha << ' ' << core << '\n';
+    }
+
+    return static_cast<bool>(outfile);
+}
+
 int Topology::getHopCost(int requesting_core, int forwarding_cha) const {
     int cost = 0;
     std::pair<int, int> requesting_core_tile{UNDEFINED, UNDEFINED};
@@ -88,7 +158,7 @@ int Topology::getHopCost(int requesting_core, int forwarding_cha) const {
     const int vertical_diff = std::abs(requesting_core_tile.first - forwarding_cha_tile.first);
     const int horizontal_diff = std::abs(requesting_core_tile.second - forwarding_cha_tile.second);
 
-    cost = vertical_diff * VERTICAL_HOP_CYCLE_COST + horizontal_diff * HORIZONTAL_HOP_CYCLE_COST;
+    cost = vertical_diff * vertical_hop_cost_ + horizontal_diff * horizontal_hop_cost_;
     // std::cout << "cha: " << forwarding_cha << ", core: " << requesting_core << ", vertical diff: " << vertical_diff
     // << ", hor diff: " << horizontal_diff <<
     // ", cost: " << cost << std::endl;
@@ -126,7 +196,7 @@ int Topology::getHopCost(int requesting_core, int forwarder_core, int coherence_
     {
         const int vertical_diff = std::abs(requesting_core_tile.first - coherence_cha_tile.first);
         const int horizontal_diff = std::abs(requesting_core_tile.second - coherence_cha_tile.second);
-        rc_cost = vertical_diff * VERTICAL_HOP_CYCLE_COST + horizontal_diff * HORIZONTAL_HOP_CYCLE_COST;
+        rc_cost = vertical_diff * vertical_hop_cost_ + horizontal_diff * horizontal_hop_cost_;
     }
     std::cout << "R - C cost: " << rc_cost << std::endl;
 
@@ -135,7 +205,7 @@ int Topology::getHopCost(int requesting_core, int forwarder_core, int coherence_
     {
         const int vertical_diff = std::abs(coherence_cha_tile.first - forwarder_core_tile.first);
         const int horizontal_diff = std::abs(coherence_cha_tile.second - forwarder_core_tile.second);
-        cf_cost = vertical_diff * VERTICAL_HOP_CYCLE_COST + horizontal_diff * HORIZONTAL_HOP_CYCLE_COST;
+        cf_cost = vertical_diff * vertical_hop_cost_ + horizontal_diff * horizontal_hop_cost_;
     }
     std::cout << "C - F cost: " << cf_cost << std::endl;
 
@@ -144,7 +214,7 @@ int Topology::getHopCost(int requesting_core, int forwarder_core, int coherence_
     {
         const int vertical_diff = std::abs(forwarder_core_tile.first - requesting_core_tile.first);
         const int horizontal_diff = std::abs(forwarder_core_tile.second - requesting_core_tile.second);
-        fr_cost = vertical_diff * VERTICAL_HOP_CYCLE_COST + horizontal_diff * HORIZONTAL_HOP_CYCLE_COST;
+        fr_cost = vertical_diff * vertical_hop_cost_ + horizontal_diff * horizontal_hop_cost_;
     }
     std::cout << "F - R cost: " << fr_cost << std::endl;
 
@@ -298,6 +368,40 @@ Tile Topology::getTileByCore(int core) {
     return {};
 }
 
+int Topology::getRowCount() const { return tiles_.size(); }
+
+int Topology::getColCount() const { return tiles_.front().size(); }
+
+int Topology::getVerticalHopCost() const { return vertical_hop_cost_; }
+
+int Topology::getHorizontalHopCost() const { return horizontal_hop_cost_; }
+
+int Topology::getBaseLatency() const { return base_latency_; }
+
+std::uint32_t Topology::buildCapid6(const std::vector<std::pair<int, int>> &enabled_tiles) {
+    std::uint32_t capid6 = 0;
+
+    // same column major traversal as the constructor.
+    int IMC_OFFSET = 0;
+    for (int j = 0; j < SKX_CPU_COL_COUNT; ++j) {
+        for (int i = 0; i < SKX_CPU_ROW_COUNT; ++i) {
+            const auto register_bit_index = j * (SKX_CPU_COL_COUNT - 1) + i - IMC_OFFSET;
+
+            auto tile_index_as_pair = std::make_pair(i, j);
+            if (tile_index_as_pair == IMC0_INDEX || tile_index_as_pair == IMC1_INDEX) {
+                ++IMC_OFFSET;
+                continue;
+            }
+
+            if (std::find(enabled_tiles.begin(), enabled_tiles.end(), tile_index_as_pair) != enabled_tiles.end()) {
+                capid6 |= (1u << register_bit_index);
+            }
+        }
+    }
+
+    return capid6;
+}
+
 Tile Topology::getTile(int x, int y) {
     for (int i = 0; i < tiles_.size(); ++i) {
         for (int j = 0; j < tiles_.front().size(); ++j) {
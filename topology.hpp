@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <map>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -16,9 +17,26 @@ static const std::map<int, int> cha_core_map{{0, 0},   {1, 28},  {2, 16},  {3, 4
                                              {14, 26}, {15, 54}, {16, 10}, {17, 38}, {18, 22}, {19, 50}, {20, 6},
                                              {21, 34}, {22, 18}, {23, 46}, {24, 2},  {25, 30}, {26, 14}, {27, 42}};
 
+static constexpr auto DEFAULT_VERTICAL_HOP_CYCLE_COST = 1;
+static constexpr auto DEFAULT_HORIZONTAL_HOP_CYCLE_COST = 2;
+
+// everything that describes one host's mesh. defaults describe koc cascade, a file written by the calibrate tool
+// overrides them.
+struct MeshConfig {
+    std::uint32_t capid6 = CAPID6;
+    std::map<int, int> cha_core_map = ::cha_core_map;
+    int vertical_hop_cost = DEFAULT_VERTICAL_HOP_CYCLE_COST;
+    int horizontal_hop_cost = DEFAULT_HORIZONTAL_HOP_CYCLE_COST;
+    int base_latency = 0;  // fixed part of a core to core transfer, on top of the hops. 0 if never calibrated.
+};
+
+bool loadMeshConfig(const std::string& filename, MeshConfig& config);
+bool saveMeshConfig(const std::string& filename, const MeshConfig& config);
+
 class Topology {
    public:
     explicit Topology(const std::map<int, int>& cha_core_map, std::uint32_t capid6);
+    explicit Topology(const MeshConfig& config);
     int getHopCost(int requesting_core, int forwarding_cha) const;
     int getHopCost(int requesting_core, int forwarder_core, int coherence_cha) const;
     void printTopology() const;
@@ -28,10 +46,21 @@ class Topology {
     Tile getTile(int cha);
     Tile getTile(int x, int y);
     Tile getTileByCore(int core);
+    int getRowCount() const;
+    int getColCount() const;
+    int getVerticalHopCost() const;
+    int getHorizontalHopCost() const;
+    int getBaseLatency() const;
+
+    // inverse of the capid6 decoding done by the constructor. tiles are (x, y) pairs.
+    static std::uint32_t buildCapid6(const std::vector<std::pair<int, int>>& enabled_tiles);
 
    private:
     std::map<int, int> cha_core_map_;
     std::vector<std::vector<Tile>> tiles_;
+    int vertical_hop_cost_ = DEFAULT_VERTICAL_HOP_CYCLE_COST;
+    int horizontal_hop_cost_ = DEFAULT_HORIZONTAL_HOP_CYCLE_COST;
+    int base_latency_ = 0;
 
     // Tile getTile(int cha);
     // Tile getTile(int x, int y);
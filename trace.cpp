@@ -0,0 +1,113 @@
+#include "trace.hpp"
+
+#include <cassert>
+#include <iostream>
+
+#include "cha.hpp"
+
+static constexpr std::uint64_t LINE_MASK = ~static_cast<std::uint64_t>(63);
+static constexpr auto FLUSH_THRESHOLD = 1 << 16;
+
+TraceWriter::TraceWriter(const std::string &filename, long n, long block_size, long thread_count)
+    : recent_(thread_count * TRACE_RECENT_LINES, TraceRecord{0, 0, 0}), next_recent_(thread_count, 0) {
+    file_ = std::fopen(filename.c_str(), "wb");
+    if (file_ == nullptr) {
+        std::cerr << "could not open trace file " << filename << '\n';
+        return;
+    }
+
+    header_.n = n;
+    header_.block_size = block_size;
+    header_.thread_count = thread_count;
+    std::fwrite(&header_, sizeof(header_), 1, file_);  // placeholder, rewritten by close().
+    buffer_.reserve(FLUSH_THRESHOLD);
+}
+
+TraceWriter::~TraceWriter() {
+    if (file_ != nullptr) {
+        close(false);
+    }
+}
+
+void TraceWriter::record(long thread, const void *address, bool is_write) {
+    if (file_ == nullptr) {
+        return;
+    }
+
+    const TraceRecord rec{reinterpret_cast<std::uintptr_t>(address) & LINE_MASK, static_cast<std::uint32_t>(thread),
+                          is_write};
+
+    std::lock_guard lock(mutex_);
+    // kernels interleave a few streams (daxpy reads b and writes a), so only comparing against the previous record
+    // would coalesce almost nothing.
+    const auto recent = recent_.begin() + thread * TRACE_RECENT_LINES;
+    for (auto i = 0; i < TRACE_RECENT_LINES; ++i) {
+        if (recent[i].line == rec.line && recent[i].is_write == rec.is_write) {
+            return;
+        }
+    }
+    recent[next_recent_[thread]] = rec;
+    next_recent_[thread] = (next_recent_[thread] + 1) % TRACE_RECENT_LINES;
+
+    buffer_.push_back(rec);
+    lines_.insert(rec.line);
+    if (buffer_.size() >= FLUSH_THRESHOLD) {
+        flush();
+    }
+}
+
+void TraceWriter::flush() {
+    std::fwrite(buffer_.data(), sizeof(TraceRecord), buffer_.size(), file_);
+    header_.record_count += buffer_.size();
+    buffer_.clear();
+}
+
+void TraceWriter::close(bool resolve_homes) {
+    std::lock_guard lock(mutex_);
+    if (file_ == nullptr) {
+        return;
+    }
+    flush();
+
+    if (resolve_homes) {
+        for (const auto line : lines_) {
+            const TraceHome home{line, findCHAByHashing(line)};
+            std::fwrite(&home, sizeof(home), 1, file_);
+        }
+        header_.home_count = lines_.size();
+    }
+
+    std::fseek(file_, 0, SEEK_SET);
+    std::fwrite(&header_, sizeof(header_), 1, file_);
+    std::fclose(file_);
+    file_ = nullptr;
+
+    std::cout << "trace: " << header_.record_count << " records, " << lines_.size() << " distinct lines, "
+              << (resolve_homes ? "homes resolved by hashing" : "homes not resolved") << std::endl;
+}
+
+bool readTrace(const std::string &filename, Trace &trace) {
+    std::FILE *file = std::fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        std::cerr << "could not open trace file " << filename << '\n';
+        return false;
+    }
+
+    bool ok = std::fread(&trace.header, sizeof(trace.header), 1, file) == 1 && trace.header.magic == TRACE_MAGIC;
+    if (ok) {
+        trace.records.resize(trace.header.record_count);
+        ok = std::fread(trace.records.data(), sizeof(TraceRecord), trace.records.size(), file) ==
+             trace.records.size();
+    }
+    for (std::uint64_t i = 0; ok && i < trace.header.home_count; ++i) {
+        TraceHome home;
+        ok = std::fread(&home, sizeof(home), 1, file) == 1;
+        trace.homes[home.line] = static_cast<int>(home.cha);
+    }
+    std::fclose(file);
+
+    if (!ok) {
+        std::cerr << "malformed trace file " << filename << '\n';
+    }
+    return ok;
+}
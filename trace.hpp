@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+static constexpr std::uint64_t TRACE_MAGIC = 0x314543415254554cULL;  // "LUTRACE1"
+static constexpr auto TRACE_RECENT_LINES = 8;
+
+struct TraceHeader {
+    std::uint64_t magic = TRACE_MAGIC;
+    std::int64_t n = 0;
+    std::int64_t block_size = 0;
+    std::int64_t thread_count = 0;
+    std::uint64_t record_count = 0;
+    std::uint64_t home_count = 0;  // number of (line, cha) pairs after the records. 0 if homes were not resolved.
+};
+
+// one access to a cache line. an access of a thread to a line it recorded with the same type among its last
+// TRACE_RECENT_LINES records is coalesced.
+struct TraceRecord {
+    std::uint64_t line;
+    std::uint32_t thread;
+    std::uint32_t is_write;
+};
+
+struct TraceHome {
+    std::uint64_t line;
+    std::int64_t cha;
+};
+
+// records the address stream of the tracking pass. thread safe.
+class TraceWriter {
+   public:
+    TraceWriter(const std::string& filename, long n, long block_size, long thread_count);
+    ~TraceWriter();
+    void record(long thread, const void* address, bool is_write);
+    // writes out remaining records and, if resolve_homes is set, the cha of every line via findCHAByHashing.
+    void close(bool resolve_homes);
+
+   private:
+    void flush();
+
+    std::FILE* file_ = nullptr;
+    std::mutex mutex_;
+    TraceHeader header_;
+    std::vector<TraceRecord> buffer_;
+    std::vector<TraceRecord> recent_;  // [thread * TRACE_RECENT_LINES + i]: recent records per thread, for coalescing.
+    std::vector<int> next_recent_;     // [thread]: slot of recent_ the next record replaces.
+    std::unordered_set<std::uint64_t> lines_;
+};
+
+struct Trace {
+    TraceHeader header;
+    std::vector<TraceRecord> records;
+    std::unordered_map<std::uint64_t, int> homes;  // line -> cha. empty when the trace was recorded without root.
+};
+
+bool readTrace(const std::string& filename, Trace& trace);